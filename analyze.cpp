@@ -0,0 +1,307 @@
+/* Eddy Gao                     Serpens - Map analyzer                       ICS3U
+Checking maps for problems. See analyze.h.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include "analyze.h"
+#include "trace.h"
+
+//the stretches of squares in each row that are in the area being looked at, joined up with union-find.
+//These are kept between calls, so checking a map again and again while it's edited doesn't allocate
+//(which means only one thread can use the analyzer at a time)
+typedef struct runset {
+    std::vector<int> begin, end;    //end is one past the last square
+    std::vector<int> rowStart;      //where each row's runs start, and one more for the end
+    std::vector<int> parent;
+    std::vector<long> size, fertile;
+    int count;
+} runset;
+
+static runset runs;
+static std::vector<unsigned char> inside, degree;
+static std::vector<long> queue;
+
+static int findroot(runset *s, int a) {
+    while (s->parent[a] != a) {
+        s->parent[a] = s->parent[s->parent[a]];
+        a = s->parent[a];
+    }
+    return a;
+}
+
+static void unite(runset *s, int a, int b) {
+    a = findroot(s, a);
+    b = findroot(s, b);
+    if (a == b) return;
+    if (s->size[a] < s->size[b]) {
+        int t = a;
+        a = b;
+        b = t;
+    }
+    s->parent[b] = a;
+    s->size[a] += s->size[b];
+    s->fertile[a] += s->fertile[b];
+}
+
+static bool isfertile(unsigned char tile) {
+    return tile == MapEmpty || tile == MapSpawn;
+}
+
+//joins up the runs of two rows that have a square above or below each other
+static void joinrows(runset *s, int a, int b) {
+    int i = s->rowStart[a], j = s->rowStart[b];
+    while (i < s->rowStart[a+1] && j < s->rowStart[b+1]) {
+        if (s->begin[i] < s->end[j] && s->begin[j] < s->end[i]) unite(s, i, j);
+        //move past whichever run finishes first
+        if (s->end[i] < s->end[j]) i++;
+        else j++;
+    }
+}
+
+//8 squares of inside at a time, the first square in the lowest byte (on little endian machines like x86)
+static uint64_t eight(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+//where the first square from x on that isn't skip (0 or 1) is, or width if there isn't one.
+//Whole words of skip squares are passed over 8 at a time
+static int skipover(const unsigned char *row, int x, int width, int skip) {
+    uint64_t same = skip ? 0x0101010101010101ULL : 0;
+    while (x + 8 <= width) {
+        uint64_t v = eight(row + x) ^ same;
+        if (v != 0) return x + __builtin_ctzll(v) / 8;
+        x += 8;
+    }
+    while (x < width && row[x] == skip) x++;
+    return x;
+}
+
+//splits the squares marked in inside into runs and joins them into areas. Afterwards every root
+//run has the size of its area and how many fertile squares are in it, which are only counted one
+//by one if countFertile is set, otherwise every open square is taken to be fertile
+static void findareas(runset *s, const unsigned char *tiles, int width, int height, bool countFertile) {
+    //a row can't have more runs than every other square
+    long most = (long)height * (width / 2 + 1);
+    if ((long)s->begin.size() < most) {
+        s->begin.resize(most);
+        s->end.resize(most);
+        s->parent.resize(most);
+        s->size.resize(most);
+        s->fertile.resize(most);
+    }
+    s->rowStart.resize(height + 1);
+    int count = 0;
+    for (int y=0; y<height; y++) {
+        const unsigned char *row = &inside[(long)y * width], *t = tiles + (long)y * width;
+        s->rowStart[y] = count;
+        int x = skipover(row, 0, width, 0);
+        while (x < width) {
+            int start = x;
+            x = skipover(row, x, width, 1);
+            long fertile = x - start;
+            if (countFertile) {
+                fertile = 0;
+                for (int i=start; i<x; i++) fertile += isfertile(t[i]);
+            }
+            s->begin[count] = start;
+            s->end[count] = x;
+            s->parent[count] = count;
+            s->size[count] = x - start;
+            s->fertile[count++] = fertile;
+            x = skipover(row, x, width, 0);
+        }
+    }
+    s->rowStart[height] = count;
+    s->count = count;
+
+    for (int y=0; y<height; y++) {
+        //the bottom row is next to the top one, if there's more than one row
+        if (y + 1 < height) joinrows(s, y, y + 1);
+        else if (height > 1) joinrows(s, y, 0);
+        //and the first square of a row is next to the last
+        int first = s->rowStart[y], last = s->rowStart[y+1] - 1;
+        if (last > first && s->begin[first] == 0 && s->end[last] == width) unite(s, first, last);
+    }
+}
+
+//the run with square (x, y) in it, or -1 if the square isn't in any
+static int findrun(runset *s, int x, int y) {
+    int low = s->rowStart[y], high = s->rowStart[y+1] - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (x < s->begin[mid]) high = mid - 1;
+        else if (x >= s->end[mid]) low = mid + 1;
+        else return mid;
+    }
+    return -1;
+}
+
+//the squares next to c going round the edges, without c itself or any twice. Returns how many
+static int around(int width, int height, long c, long *next) {
+    int x = c % width, y = c / width, n = 0;
+    long all[4] = {(long)(y > 0 ? y - 1 : height - 1) * width + x, (long)(y < height - 1 ? y + 1 : 0) * width + x,
+                   (long)y * width + (x > 0 ? x - 1 : width - 1), (long)y * width + (x < width - 1 ? x + 1 : 0)};
+    for (int i=0; i<4; i++) {
+        bool seen = all[i] == c;
+        for (int j=0; j<n && !seen; j++) seen = next[j] == all[i];
+        if (!seen) next[n++] = all[i];
+    }
+    return n;
+}
+
+//counts the open squares next to c, and queues it up if it's a dead end
+static void checkdegree(int width, int height, long c, long *tail) {
+    long next[4];
+    int n = around(width, height, c, next);
+    degree[c] = 0;
+    for (int i=0; i<n; i++) degree[c] += inside[next[i]];
+    if (inside[c] && degree[c] < 2) queue[(*tail)++] = c;
+}
+
+//checks a map, spawnx and spawny are where the map says the spawn point is, -1 if it doesn't
+bool analyzemap(mapreport *r, const unsigned char *tiles, int width, int height, int spawnx, int spawny) {
+    TRACE("analyzemap");
+    long squares = (long)width * height;
+    memset(r, 0, sizeof(mapreport));
+    if (width < 1 || height < 1) return false;
+    r->width = width;
+    r->height = height;
+    inside.resize(squares);
+    degree.resize(squares);
+
+    //counted in locals, since writing to r every square would make the compiler think tiles changed
+    long open = 0, fertile = 0, spawns = 0;
+    for (long c=0; c<squares; c++) {
+        open += inside[c] = tiles[c] != MapWall;
+        fertile += isfertile(tiles[c]);
+        spawns += tiles[c] == MapSpawn;
+    }
+    r->open = open;
+    r->fertile = fertile;
+    r->spawns = spawns;
+    //the game falls back on the top left corner
+    r->spawnx = spawnx != -1 ? spawnx : 0;
+    r->spawny = spawny != -1 ? spawny : 0;
+    if (r->spawnx >= width || r->spawny >= height) r->spawnx = r->spawny = 0;
+    long spawn = (long)r->spawny * width + r->spawnx, next[4];
+    r->spawnWall = tiles[spawn] == MapWall;
+    int n = around(width, height, spawn, next);
+    for (int i=0; i<n; i++) r->spawnDegree += inside[next[i]];
+
+    //the open areas, and the one the spawn point is in
+    //most maps don't have infertile squares, then the fertile ones are just the open ones
+    findareas(&runs, tiles, width, height, fertile != open);
+    for (int i=0; i<runs.count; i++) {
+        if (findroot(&runs, i) != i) continue;
+        r->regions++;
+        if (runs.size[i] > r->largest) r->largest = runs.size[i];
+    }
+    int start = findrun(&runs, r->spawnx, r->spawny);
+    if (start != -1) {
+        start = findroot(&runs, start);
+        r->reachable = runs.size[start];
+        r->reachableFertile = runs.fertile[start];
+    }
+    r->unreachableFertile = r->fertile - r->reachableFertile;
+
+    //peel off dead ends: a square with only one open neighbour (or none) is the end of one,
+    //and taking it away can leave the square before it as the new end
+    long head = 0, tail = 0;
+    queue.resize(squares);
+    const uint64_t ones = 0x0101010101010101ULL;
+    for (int y=0; y<height; y++) {
+        const unsigned char *row = &inside[(long)y * width];
+        const unsigned char *up = &inside[(long)(y > 0 ? y - 1 : height - 1) * width];
+        const unsigned char *down = &inside[(long)(y < height - 1 ? y + 1 : 0) * width];
+        unsigned char *d = &degree[(long)y * width];
+        int x = 0;
+        //away from the edges 8 squares' neighbours are added up at once, each byte is at most 4 so
+        //nothing carries into the next one. A byte is a dead end if it's inside and its count is 0 or 1
+        if (width >= 10 && height >= 3) {
+            for (x=1; x+8<width; x+=8) {
+                uint64_t sum = eight(up + x) + eight(down + x) + eight(row + x - 1) + eight(row + x + 1);
+                memcpy(d + x, &sum, 8);
+                uint64_t ends = eight(row + x) & ~((sum >> 1) | (sum >> 2)) & ones;
+                while (ends != 0) {
+                    queue[tail++] = (long)y * width + x + __builtin_ctzll(ends) / 8;
+                    ends &= ends - 1;
+                }
+            }
+        }
+        //the rest one at a time, going round the edges
+        for (int i=x; i<width; i++) checkdegree(width, height, (long)y * width + i, &tail);
+        if (x > 0) checkdegree(width, height, (long)y * width, &tail);
+    }
+    while (head < tail) {
+        long c = queue[head++];
+        inside[c] = 0;
+        n = around(width, height, c, next);
+        for (int i=0; i<n; i++) {
+            if (inside[next[i]] && degree[next[i]]-- == 2) queue[tail++] = next[i];
+        }
+    }
+    r->deadEnds = tail;
+
+    //what's left is safe to go round and round in. If nothing was peeled off the areas are the same as before
+    if (tail > 0) findareas(&runs, tiles, width, height, false);
+    r->loopx = r->loopy = -1;
+    for (int i=0; i<runs.count; i++) {
+        int root = findroot(&runs, i);
+        if (runs.size[root] <= r->loopSafe) continue;
+        r->loopSafe = runs.size[root];
+        r->loopx = runs.begin[i];
+        r->loopy = std::upper_bound(runs.rowStart.begin(), runs.rowStart.end(), i) - runs.rowStart.begin() - 1;
+    }
+    return true;
+}
+
+//walls in the areas that aren't the biggest one, so a map made at random is all in one piece
+long keepbiggest(unsigned char *tiles, int width, int height) {
+    TRACE("keepbiggest");
+    long squares = (long)width * height;
+    if (width < 1 || height < 1) return 0;
+    inside.resize(squares);
+    for (long c=0; c<squares; c++) inside[c] = tiles[c] != MapWall;
+    findareas(&runs, tiles, width, height, false);
+    int biggest = -1;
+    for (int i=0; i<runs.count; i++) {
+        if (findroot(&runs, i) == i && (biggest == -1 || runs.size[i] > runs.size[biggest])) biggest = i;
+    }
+    if (biggest == -1) return 0;
+    for (int y=0; y<height; y++) {
+        for (int i=runs.rowStart[y]; i<runs.rowStart[y+1]; i++) {
+            if (findroot(&runs, i) != biggest) memset(tiles + (long)y * width + runs.begin[i], MapWall, runs.end[i] - runs.begin[i]);
+        }
+    }
+    return runs.size[biggest];
+}
+
+//describes what's wrong with a map, one line per problem, and returns how many there are
+int mapproblems(const mapreport *r, char problems[][128], int max) {
+    int n = 0;
+    #define PROBLEM(...) if (n < max) snprintf(problems[n++], 128, __VA_ARGS__)
+    if (r->spawns == 0) {
+        PROBLEM("no spawn point, the snake starts at (0, 0)%s", r->spawnWall ? " which is a wall" : "");
+    } else if (r->spawnWall) {
+        PROBLEM("the spawn point (%d, %d) is a wall", r->spawnx, r->spawny);
+    }
+    if (r->spawns > 1) PROBLEM("%d spawn points, only the one at (%d, %d) is used", r->spawns, r->spawnx, r->spawny);
+    if (!r->spawnWall && r->spawnDegree == 0) PROBLEM("the spawn point (%d, %d) is walled in", r->spawnx, r->spawny);
+    if (r->fertile == 0) {
+        PROBLEM("there's nowhere for food to go");
+    } else if (r->reachableFertile == 0) {
+        PROBLEM("the snake can't get to any of the food squares");
+    }
+    if (r->unreachableFertile > 0 && r->reachableFertile > 0) {
+        PROBLEM("%ld of %ld food squares can't be reached from the spawn point", r->unreachableFertile, r->fertile);
+    }
+    if (r->loopSafe == 0 && r->open > 0) PROBLEM("there's no loop anywhere, the snake can't keep going for long");
+    #undef PROBLEM
+    return n;
+}
@@ -0,0 +1,45 @@
+/* Eddy Gao                     Serpens - Map analyzer                       ICS3U
+Finds the things that quietly break a map: a spawn point that's walled in or
+missing (the game then starts the snake at (0, 0), wall or not), food squares the
+snake can never get to, and dead ends. The map wraps around its edges just like it
+does in the game.
+The open squares are split into runs along each row, and the runs are joined with
+union-find to the runs they touch in the rows above and below, so the work depends
+on how many runs there are more than how many squares, and long runs of walls or open
+squares are skipped over 8 at a time. A million square map made of corridors takes
+a few milliseconds (random noise, which is nearly all short runs, takes a few times
+that), so the mapmaker can check its maps after every change without anyone noticing.
+mapcheck.cpp runs it on map files from the command line.
+*/
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include "mapfile.h"
+
+typedef struct mapreport {
+    int width, height;
+    long open, fertile;     //squares that aren't walls, and the ones food can go on
+    //the number of spawn tiles, and the square the game will start on, which
+    //is (0, 0) if the map doesn't have a spawn point
+    int spawns, spawnx, spawny;
+    bool spawnWall;         //the spawn point is on a wall
+    int spawnDegree;        //open squares next to the spawn point, the snake needs at least one
+    //separate open areas, and how big the biggest is
+    int regions;
+    long largest;
+    //open squares the snake can get to from the spawn point, and the food squares among
+    //them. Food can still go on the others, where it'll never be eaten
+    long reachable, reachableFertile, unreachableFertile;
+    //squares in dead ends, that a snake can't turn around in. What's left over is the
+    //squares that are on a loop or between loops, loopSafe is the biggest area of those
+    //and (loopx, loopy) is one of its squares, or -1 if there isn't one
+    long deadEnds, loopSafe;
+    int loopx, loopy;
+} mapreport;
+
+bool analyzemap(mapreport *r, const unsigned char *tiles, int width, int height, int spawnx, int spawny);
+int mapproblems(const mapreport *r, char problems[][128], int max);
+//walls in every open area but the biggest, and returns how big that one is
+long keepbiggest(unsigned char *tiles, int width, int height);
+
+#endif
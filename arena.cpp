@@ -0,0 +1,240 @@
+/* Eddy Gao                     Serpens - Arena                              ICS3U
+Games with more than one snake. See arena.h.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+//how many free squares are looked at to find each snake somewhere to start away from the others
+const int spawnTries = 32;
+
+bool ainit(arena *a) {
+    for (int p=0; p<maxSnakes; p++) {
+        a->players[p].body.cells = NULL;
+        a->players[p].body.capacity = 0;
+    }
+    a->numPlayers = a->alive = a->numFood = a->tick = 0;
+    return einit(&a->board);
+}
+
+void adestroy(arena *a) {
+    for (int p=0; p<maxSnakes; p++) sdestroy(&a->players[p].body);
+    edestroy(&a->board);
+}
+
+//how far apart two squares are, going round the edges if that's shorter
+static int distance(engine *b, int x1, int y1, int x2, int y2) {
+    int dx = abs(x1 - x2), dy = abs(y1 - y2);
+    if (dx > b->width - dx) dx = b->width - dx;
+    if (dy > b->height - dy) dy = b->height - dy;
+    return dx + dy;
+}
+
+//puts food number i on a random free square, false if there isn't one
+static bool afood(arena *a, int i) {
+    engine *b = &a->board;
+    if (b->numFree == 0) {
+        a->foodx[i] = a->foody[i] = -1;
+        return false;
+    }
+    int c = b->freeCells[rngrange(&b->random, b->numFree)];
+    a->foodx[i] = c % b->width;
+    a->foody[i] = c / b->width;
+    setgrid(b, a->foodx[i], a->foody[i], Food);
+    return true;
+}
+
+//takes a dead snake off the grid, so the others can carry on round it
+static void aremove(arena *a, player *pl) {
+    engine *b = &a->board;
+    for (int i=0; i<pl->body.length; i++) {
+        segment *s = getElem(&pl->body, i);
+        setgrid(b, s->x, s->y, getmap(b, s->x, s->y));
+    }
+}
+
+//starts a game with the given number of snakes on the board's map. The first snake starts on
+//the map's spawn point and the others as far from the rest as can be found quickly
+bool anewgame(arena *a, int players, uint64_t seed) {
+    engine *b = &a->board;
+    int squares = b->width * b->height;
+    if (players < 1 || players > maxSnakes) return false;
+    b->seed = seed;
+    rngseed(&b->random, seed);
+    memcpy(b->grid, b->map, sizeof(uint64_t) * b->stride * b->height);
+    indexgrid(b);
+    a->numPlayers = a->alive = 0;
+    a->tick = 0;
+
+    for (int p=0; p<players; p++) {
+        player *pl = &a->players[p];
+        if (pl->body.capacity != squares) {
+            sdestroy(&pl->body);
+            if (!sinit(&pl->body, squares)) return false;
+        }
+        sclear(&pl->body);
+
+        int x = b->spawnx, y = b->spawny;
+        if (p > 0 || getgrid(b, x, y) != Empty) {
+            if (b->numFree == 0) return false;
+            int best = -1;
+            for (int t=0; t<spawnTries; t++) {
+                int c = b->freeCells[rngrange(&b->random, b->numFree)], nearest = squares;
+                for (int q=0; q<p; q++) {
+                    int d = distance(b, c % b->width, c / b->width, a->players[q].posx, a->players[q].posy);
+                    if (d < nearest) nearest = d;
+                }
+                if (nearest > best) {
+                    best = nearest;
+                    x = c % b->width;
+                    y = c / b->width;
+                }
+            }
+        }
+
+        pl->posx = x;
+        pl->posy = y;
+        pl->velx = pl->vely = 0;
+        pl->extend = 10;
+        pl->score = 0;
+        pl->alive = true;
+        pl->events = 0;
+        sappend(&pl->body, x, y);
+        setgrid(b, x, y, (GridSquare)(Owned + p));
+        a->numPlayers++;
+        a->alive++;
+    }
+
+    a->numFood = players;
+    for (int i=0; i<a->numFood; i++) afood(a, i);
+    return true;
+}
+
+//whether a snake is allowed to turn this way, it can't reverse into itself
+bool acanturn(player *pl, int direction) {
+    switch (direction) {
+    case Up:
+    case Down:
+        return pl->vely == 0;
+    case Left:
+    case Right:
+        return pl->velx == 0;
+    }
+    return false;
+}
+
+//advances every snake by one tick, directions has a direction (or None) for each of them.
+//Returns every event that happened to any snake, each snake's own are in its events
+int astep(arena *a, const int *directions) {
+    engine *b = &a->board;
+    int events = 0;
+    int targetx[maxSnakes], targety[maxSnakes];
+    bool moving[maxSnakes], dying[maxSnakes], ate[maxSnakes];
+    a->tick++;
+
+    //turn, and move the tails out of the way first, so a snake can follow right behind another
+    for (int p=0; p<a->numPlayers; p++) {
+        player *pl = &a->players[p];
+        pl->events = 0;
+        moving[p] = dying[p] = ate[p] = false;
+        if (!pl->alive) continue;
+        if (acanturn(pl, directions[p])) {
+            pl->velx = (directions[p] == Right) - (directions[p] == Left);
+            pl->vely = (directions[p] == Down) - (directions[p] == Up);
+        }
+        if (pl->velx == 0 && pl->vely == 0) continue;
+        moving[p] = true;
+
+        if (pl->extend == 0) {
+            pl->leftover = spop(&pl->body);
+            setgrid(b, pl->leftover.x, pl->leftover.y, getmap(b, pl->leftover.x, pl->leftover.y));
+            pl->events |= TailMoved;
+        } else --pl->extend;
+
+        int x = pl->posx + pl->velx, y = pl->posy + pl->vely;
+        if (x < 0) x += b->width;
+        if (x >= b->width) x -= b->width;
+        if (y < 0) y += b->height;
+        if (y >= b->height) y -= b->height;
+        targetx[p] = x;
+        targety[p] = y;
+    }
+
+    //heads that meet on the same square kill each other, and anything else a head runs into kills it
+    for (int p=0; p<a->numPlayers; p++) {
+        if (!moving[p]) continue;
+        for (int q=p+1; q<a->numPlayers; q++) {
+            if (moving[q] && targetx[p] == targetx[q] && targety[p] == targety[q]) dying[p] = dying[q] = true;
+        }
+        GridSquare target = getgrid(b, targetx[p], targety[p]);
+        if (target == Snake || target >= Owned) dying[p] = true;
+        ate[p] = !dying[p] && target == Food;
+    }
+    for (int p=0; p<a->numPlayers; p++) {
+        if (!dying[p]) continue;
+        player *pl = &a->players[p];
+        aremove(a, pl);
+        pl->alive = false;
+        pl->events |= Died;
+        a->alive--;
+    }
+
+    //the rest move in, then the food that was eaten goes somewhere else, now that nothing else will move
+    for (int p=0; p<a->numPlayers; p++) {
+        if (!moving[p] || dying[p]) continue;
+        player *pl = &a->players[p];
+        pl->posx = targetx[p];
+        pl->posy = targety[p];
+        sappend(&pl->body, pl->posx, pl->posy);
+        setgrid(b, pl->posx, pl->posy, (GridSquare)(Owned + p));
+        pl->events |= Moved;
+        if (ate[p]) {
+            pl->events |= Ate;
+            pl->score += 10;
+            pl->extend++;
+        }
+    }
+    for (int p=0; p<a->numPlayers; p++) {
+        if (!ate[p]) continue;
+        for (int i=0; i<a->numFood; i++) {
+            if (a->foodx[i] != targetx[p] || a->foody[i] != targety[p]) continue;
+            //if there's nowhere left to put it the board is full
+            if (!afood(a, i)) a->players[p].events |= Won;
+        }
+    }
+
+    for (int p=0; p<a->numPlayers; p++) events |= a->players[p].events;
+    return events;
+}
+
+//a simple bot: heads for the nearest food, and won't go anywhere it would die this tick if it
+//has a choice. Squares another snake's head could get to at the same time are avoided too
+int abot(arena *a, int p) {
+    engine *b = &a->board;
+    player *pl = &a->players[p];
+    int reach = b->width + b->height, best = None, bestScore = 0;
+    for (int direction=Up; direction<=Right; direction++) {
+        //any way but backwards
+        int dx = (direction == Right) - (direction == Left), dy = (direction == Down) - (direction == Up);
+        if ((pl->velx || pl->vely) && dx == -pl->velx && dy == -pl->vely) continue;
+        int x = (pl->posx + dx + b->width) % b->width;
+        int y = (pl->posy + dy + b->height) % b->height;
+        GridSquare target = getgrid(b, x, y);
+        if (target == Snake || target >= Owned) continue;
+
+        int score = 0;
+        for (int i=0; i<a->numFood; i++) {
+            if (a->foodx[i] != -1 && reach - distance(b, x, y, a->foodx[i], a->foody[i]) > score) {
+                score = reach - distance(b, x, y, a->foodx[i], a->foody[i]);
+            }
+        }
+        for (int q=0; q<a->numPlayers; q++) {
+            if (q != p && a->players[q].alive && distance(b, x, y, a->players[q].posx, a->players[q].posy) == 1) score -= 2 * reach;
+        }
+        if (best == None || score > bestScore) {
+            best = direction;
+            bestScore = score;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,45 @@
+/* Eddy Gao                     Serpens - Arena                              ICS3U
+Games with 2 to 8 snakes on the same map, for playing against each other on one
+keyboard or watching bots fight it out. The map, the grid and the list of free
+squares are kept in an engine, which already knows how to load maps. Every snake
+square on the grid says which snake it belongs to (Owned + the snake's number),
+so running into a snake can be told apart from running into a wall.
+Every tick all the snakes move at once: all the heads are worked out first, heads
+that land on the same square kill each other, and the food that was eaten is only
+put back once every snake has moved.
+*/
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include "engine.h"
+
+const int maxSnakes = 8;
+
+typedef struct player {
+    snake body;
+    segment leftover;
+    int posx, posy, velx, vely;
+    int extend, score;
+    bool alive;
+    int events;     //what happened to this snake last tick, a combination of Events
+} player;
+
+typedef struct arena {
+    //the map and what's on it, the engine's own snake isn't used
+    engine board;
+    player players[maxSnakes];
+    int numPlayers, alive;
+    //there is a food for every snake, so there's always something to go for
+    int foodx[maxSnakes], foody[maxSnakes], numFood;
+    int tick;
+} arena;
+
+bool ainit(arena *a);
+void adestroy(arena *a);
+bool anewgame(arena *a, int players, uint64_t seed);
+bool acanturn(player *p, int direction);
+int astep(arena *a, const int *directions);
+int abot(arena *a, int p);
+
+#endif
@@ -0,0 +1,273 @@
+/* Eddy Gao                     Serpens - Assets                             ICS3U
+The asset registry. See assets.h.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "assets.h"
+#include "perf.h"
+
+//the most different files the registry can hold
+const int maxAssets = 32;
+
+//everything the game loads, read in this order, so the menu's picture comes first
+const char *preload[] = {
+    "controls.bmp",
+    "play.bmp",
+    "map.bmp",
+    "button.wav",
+    "tetris.mid",
+    "bite.wav"
+};
+const int numPreload = sizeof(preload) / sizeof(preload[0]);
+
+static asset assets[maxAssets];
+static int numAssets = 0;
+
+//guards done (and data and size until done is set), and wakes up the main thread when a file is read
+static std::mutex lock;
+static std::condition_variable loaded;
+static std::thread loader;
+
+//how long the loading thread took, and how much it read
+static double loadTime;
+static long loadBytes;
+
+//a PACKFILE that reads out of an asset's data, so allegro can load it without the disk
+typedef struct memfile {
+    const char *data;
+    long size, pos;
+} memfile;
+
+static int memclose(void *f) {
+    return 0;
+}
+
+static int memgetc(void *f) {
+    memfile *m = (memfile*)f;
+    return m->pos < m->size ? (unsigned char)m->data[m->pos++] : EOF;
+}
+
+static int memungetc(int c, void *f) {
+    memfile *m = (memfile*)f;
+    if (m->pos == 0) return EOF;
+    m->pos--;
+    return c;
+}
+
+static long memread(void *p, long n, void *f) {
+    memfile *m = (memfile*)f;
+    if (n > m->size - m->pos) n = m->size - m->pos;
+    memcpy(p, m->data + m->pos, n);
+    m->pos += n;
+    return n;
+}
+
+static int memputc(int c, void *f) {
+    return EOF;
+}
+
+static long memwrite(const void *p, long n, void *f) {
+    return 0;
+}
+
+static int memseek(void *f, int offset) {
+    memfile *m = (memfile*)f;
+    if (offset < 0 || offset > m->size - m->pos) return -1;
+    m->pos += offset;
+    return 0;
+}
+
+static int memeof(void *f) {
+    memfile *m = (memfile*)f;
+    return m->pos >= m->size;
+}
+
+static int memerror(void *f) {
+    return 0;
+}
+
+static const PACKFILE_VTABLE memvtable = {
+    memclose, memgetc, memungetc, memread, memputc, memwrite, memseek, memeof, memerror
+};
+
+//reads a whole file into memory, returns NULL if it can't
+static char *readfile(const char *file, long *size) {
+    FILE *f = fopen(file, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = (char*)malloc(*size > 0 ? *size : 1);
+    if (data != NULL && (long)fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static void setdata(asset *a, char *data, long size) {
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        a->data = data;
+        a->size = data ? size : 0;
+        a->done = true;
+    }
+    loaded.notify_all();
+}
+
+//the loading thread, it only touches the assets in preload, which never move
+static void loadall() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long bytes = 0;
+    for (int i=0; i<numPreload; i++) {
+        long size = 0;
+        char *data = readfile(assets[i].file, &size);
+        if (data) bytes += size;
+        setdata(&assets[i], data, size);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    loadTime = elapsed.count();
+    loadBytes = bytes;
+}
+
+static int assettype(const char *file) {
+    const char *ext = strrchr(file, '.');
+    if (ext != NULL && strcmp(ext, ".wav") == 0) return AssetSample;
+    if (ext != NULL && strcmp(ext, ".mid") == 0) return AssetMidi;
+    return AssetBitmap;
+}
+
+static asset *addasset(const char *file) {
+    if (numAssets == maxAssets) return NULL;
+    asset *a = &assets[numAssets++];
+    strncpy(a->file, file, sizeof(a->file) - 1);
+    a->file[sizeof(a->file) - 1] = '\0';
+    a->type = assettype(file);
+    a->data = NULL;
+    a->size = 0;
+    a->done = false;
+    a->object = NULL;
+    a->refs = 0;
+    return a;
+}
+
+//starts reading in all of the game's files in the background, the registry holds a reference to each
+void startassets() {
+    for (int i=0; i<numPreload; i++) addasset(preload[i])->refs = 1;
+    loader = std::thread(loadall);
+}
+
+//waits for the loading thread and frees everything, how many were still in use goes in perf.csv
+void stopassets() {
+    if (loader.joinable()) loader.join();
+    int leftover = 0;
+    for (int i=0; i<numAssets; i++) {
+        //the registry's own reference
+        if (i < numPreload) dropasset(&assets[i]);
+        if (assets[i].refs > 0) {
+            leftover++;
+            assets[i].refs = 1;
+            dropasset(&assets[i]);
+        }
+        free(assets[i].data);
+    }
+    numAssets = 0;
+    perfnote("assets_still_in_use", leftover);
+}
+
+//gets a reference to a file's asset, one the registry doesn't know about is read right away
+asset *useasset(const char *file) {
+    for (int i=0; i<numAssets; i++) {
+        if (strcmp(assets[i].file, file) == 0) {
+            assets[i].refs++;
+            return &assets[i];
+        }
+    }
+    asset *a = addasset(file);
+    if (a == NULL) return NULL;
+    long size = 0;
+    char *data = readfile(file, &size);
+    setdata(a, data, size);
+    a->refs = 1;
+    return a;
+}
+
+//gives back a reference, once nothing uses an asset the allegro object made from it goes,
+//but the file stays in memory in case it's needed again
+void dropasset(asset *a) {
+    if (a == NULL || --a->refs > 0 || a->object == NULL) return;
+    switch (a->type) {
+    case AssetBitmap:
+        destroy_bitmap((BITMAP*)a->object);
+        break;
+    case AssetSample:
+        destroy_sample((SAMPLE*)a->object);
+        break;
+    case AssetMidi:
+        destroy_midi((MIDI*)a->object);
+        break;
+    }
+    a->object = NULL;
+}
+
+//makes the allegro object for an asset if it hasn't been made yet, waiting for the file if it
+//hasn't been read yet. Has to be called on the main thread
+static void *getobject(asset *a) {
+    if (a == NULL) return NULL;
+    if (a->object) return a->object;
+    {
+        std::unique_lock<std::mutex> hold(lock);
+        loaded.wait(hold, [a] { return a->done; });
+    }
+    if (a->data == NULL) return NULL;
+
+    memfile m = {a->data, a->size, 0};
+    PACKFILE *f;
+    switch (a->type) {
+    case AssetBitmap:
+        f = pack_fopen_vtable(&memvtable, &m);
+        if (f) {
+            a->object = load_bmp_pf(f, NULL);
+            pack_fclose(f);
+        }
+        break;
+    case AssetSample:
+        f = pack_fopen_vtable(&memvtable, &m);
+        if (f) {
+            a->object = load_wav_pf(f);
+            pack_fclose(f);
+        }
+        break;
+    case AssetMidi:
+        //allegro can only load midis from a file, but reading it in has put it in the disk cache
+        a->object = load_midi(a->file);
+        break;
+    }
+    return a->object;
+}
+
+BITMAP *assetbitmap(asset *a) {
+    return a && a->type == AssetBitmap ? (BITMAP*)getobject(a) : NULL;
+}
+
+SAMPLE *assetsample(asset *a) {
+    return a && a->type == AssetSample ? (SAMPLE*)getobject(a) : NULL;
+}
+
+MIDI *assetmidi(asset *a) {
+    return a && a->type == AssetMidi ? (MIDI*)getobject(a) : NULL;
+}
+
+//notes down how long the loading thread took for perf.csv, once it's finished
+void assetreport() {
+    if (loader.joinable()) loader.join();
+    perfnote("asset_files", numPreload);
+    perfnote("asset_kb", loadBytes / 1024.0);
+    perfnote("asset_load_ms", loadTime);
+}
@@ -0,0 +1,43 @@
+/* Eddy Gao                     Serpens - Assets                             ICS3U
+Every picture and sound the game uses, loaded once and shared. The files are read
+off the disk on a separate thread as soon as the game starts, so by the time they
+are needed they are already in memory and only have to be turned into allegro
+bitmaps and samples, which happens on the main thread since allegro needs that.
+Anything that uses an asset holds a reference to it with useasset() and gives it
+back with dropasset(). The files the game knows it needs are held by the registry
+as well, so they stay loaded until stopassets().
+*/
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <allegro.h>
+
+enum AssetType {
+    AssetBitmap = 0,
+    AssetSample,
+    AssetMidi
+};
+
+typedef struct asset {
+    char file[64];
+    int type;
+    //the file's contents, filled in by the loading thread. done is set once it's
+    //been read (or failed to be), the rest shouldn't be looked at before that
+    char *data;
+    long size;
+    bool done;
+    //the allegro bitmap, sample or midi made from data, NULL until it's first needed
+    void *object;
+    int refs;
+} asset;
+
+void startassets();
+void stopassets();
+asset *useasset(const char *file);
+void dropasset(asset *a);
+BITMAP *assetbitmap(asset *a);
+SAMPLE *assetsample(asset *a);
+MIDI *assetmidi(asset *a);
+void assetreport();
+
+#endif
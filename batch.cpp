@@ -0,0 +1,261 @@
+/* Eddy Gao                     Serpens - Batch simulator                    ICS3U
+Plays lots of games with no window, using every core, to compare the bots. Every
+game gets its own seed, one of the maps and one of the bots, and the results are
+added up for every bot on every map.
+This does not need allegro, build it with:
+    g++ -O2 -pthread batch.cpp engine.cpp mapfile.cpp path.cpp pool.cpp -o batch
+Usage:
+    batch [-n games] [-j threads] [-s seed] [-b bot,bot...] [map files...]
+With no map files it uses every .txt map in maps/. The bots are wander, greedy and
+autopilot, all of them unless -b says otherwise.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include "engine.h"
+#include "path.h"
+#include "pool.h"
+
+//a game that goes this long without the snake eating is stopped, the bot is going in circles
+const int maxHungry = 20000;
+
+typedef struct botstate {
+    pathfinder pilot;
+    rng random;
+} botstate;
+
+//picks a random direction that doesn't run into anything right away
+int wander(engine *e, botstate *b) {
+    int dirs[4] = {Up, Down, Left, Right};
+    int start = rngrange(&b->random, 4);
+    for (int i=0; i<4; i++) {
+        int d = dirs[(start + i) % 4];
+        int dx = (d == Right) - (d == Left), dy = (d == Down) - (d == Up);
+        //going straight on is allowed, only turning back into itself isn't
+        if (dx == -e->velx && dy == -e->vely) continue;
+        int x = (e->posx + dx + e->width) % e->width;
+        int y = (e->posy + dy + e->height) % e->height;
+        if (getgrid(e, x, y) != Snake) return d;
+    }
+    return None;
+}
+
+int greedybot(engine *e, botstate *b) {
+    return greedy(e);
+}
+
+int autopilotbot(engine *e, botstate *b) {
+    return steer(&b->pilot, e);
+}
+
+typedef struct bot {
+    const char *name;
+    int (*move)(engine *e, botstate *b);
+} bot;
+
+const bot bots[] = {
+    {"wander", wander},
+    {"greedy", greedybot},
+    {"autopilot", autopilotbot}
+};
+const int numBots = sizeof(bots) / sizeof(bots[0]);
+
+//totals for one bot on one map
+typedef struct results {
+    long games, wins, starved;
+    long score, length, ticks, food, hungry;
+    int best;
+} results;
+
+//everything one thread uses, nothing in here is touched by any other thread. The bot's state
+//changes every tick, so each worker starts on its own cache line to keep the threads from
+//slowing each other down
+typedef struct alignas(64) worker {
+    engine *engines;    //one for each map, loaded the first time it's needed
+    bool *loaded;
+    botstate state;
+    results *totals;    //one for each bot on each map
+} worker;
+
+typedef struct batch {
+    std::vector<std::string> maps;
+    std::vector<int> bots;
+    uint64_t seed;
+    std::vector<worker> workers;
+    //set by a thread that couldn't load a map, checked once they've all finished
+    std::atomic<bool> failed;
+} batch;
+
+//plays one game to the end, job decides the seed, the map and the bot
+void play(int job, int w, void *data) {
+    batch *b = (batch*)data;
+    worker *me = &b->workers[w];
+    int m = job % b->maps.size();
+    int k = (job / b->maps.size()) % b->bots.size();
+    engine *e = &me->engines[m];
+    results *r = &me->totals[m * numBots + b->bots[k]];
+
+    if (!me->loaded[m]) {
+        einit(e);
+        if (!loadMap(e, b->maps[m].c_str())) {
+            edestroy(e);
+            b->failed = true;
+            return;
+        }
+        me->loaded[m] = true;
+    }
+    uint64_t seed = b->seed + job;
+    newgame(e, seed);
+    rngseed(&me->state.random, ~seed);
+
+    int events = 0, food = 0, lastAte = 0;
+    const bot *player = &bots[b->bots[k]];
+    while (!(events & (Died | Won))) {
+        events = step(e, player->move(e, &me->state));
+        if (events & (Ate | AteSpecial)) {
+            food++;
+            lastAte = e->tick;
+        }
+        if (e->tick - lastAte > maxHungry) {
+            r->starved++;
+            break;
+        }
+    }
+
+    r->games++;
+    if (events & Won) r->wins++;
+    r->score += e->score;
+    r->length += e->body.length;
+    r->ticks += e->tick;
+    r->food += food;
+    r->hungry += e->tick - lastAte;
+    if (e->score > r->best) r->best = e->score;
+}
+
+//finds every text map in a directory
+void findmaps(std::vector<std::string> *maps, const char *dir) {
+    DIR *d = opendir(dir);
+    if (d == NULL) return;
+    struct dirent *f;
+    while ((f = readdir(d)) != NULL) {
+        const char *ext = strrchr(f->d_name, '.');
+        if (ext != NULL && strcmp(ext, ".txt") == 0) maps->push_back(std::string(dir) + "/" + f->d_name);
+    }
+    closedir(d);
+    std::sort(maps->begin(), maps->end());
+}
+
+bool pickbots(std::vector<int> *chosen, char *list) {
+    for (char *name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+        int i = 0;
+        while (i < numBots && strcmp(bots[i].name, name) != 0) i++;
+        if (i == numBots) {
+            fprintf(stderr, "unknown bot %s\n", name);
+            return false;
+        }
+        chosen->push_back(i);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    batch b;
+    int games = 1000, threads = numcores();
+    b.seed = 1;
+    b.failed = false;
+
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) b.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            if (!pickbots(&b.bots, argv[++i])) return 1;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [-n games] [-j threads] [-s seed] [-b bot,bot...] [map files...]\n", argv[0]);
+            return 1;
+        } else b.maps.push_back(argv[i]);
+    }
+    if (b.maps.empty()) findmaps(&b.maps, "maps");
+    if (b.maps.empty()) {
+        fprintf(stderr, "no maps to play on\n");
+        return 1;
+    }
+    if (b.bots.empty()) for (int i=0; i<numBots; i++) b.bots.push_back(i);
+    if (threads < 1) threads = 1;
+
+    //check every map loads before starting, a thread that finds one that doesn't can't stop the others
+    engine check;
+    einit(&check);
+    for (size_t m=0; m<b.maps.size(); m++) {
+        if (!loadMap(&check, b.maps[m].c_str())) {
+            fprintf(stderr, "could not load %s\n", b.maps[m].c_str());
+            return 1;
+        }
+    }
+    edestroy(&check);
+
+    int cells = b.maps.size() * numBots;
+    b.workers.resize(threads);
+    for (int i=0; i<threads; i++) {
+        worker *w = &b.workers[i];
+        w->engines = (engine*)malloc(sizeof(engine) * b.maps.size());
+        w->loaded = (bool*)calloc(b.maps.size(), sizeof(bool));
+        w->totals = (results*)calloc(cells, sizeof(results));
+        pinit(&w->state.pilot);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    runjobs(games, threads, play, &b);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    //add up what every thread found
+    std::vector<results> totals(cells);
+    memset(&totals[0], 0, sizeof(results) * cells);
+    for (int i=0; i<threads; i++) {
+        worker *w = &b.workers[i];
+        for (int c=0; c<cells; c++) {
+            results *in = &w->totals[c], *out = &totals[c];
+            out->games += in->games;
+            out->wins += in->wins;
+            out->starved += in->starved;
+            out->score += in->score;
+            out->length += in->length;
+            out->ticks += in->ticks;
+            out->food += in->food;
+            out->hungry += in->hungry;
+            if (in->best > out->best) out->best = in->best;
+        }
+        for (size_t m=0; m<b.maps.size(); m++) if (w->loaded[m]) edestroy(&w->engines[m]);
+        pdestroy(&w->state.pilot);
+        free(w->engines);
+        free(w->loaded);
+        free(w->totals);
+    }
+
+    if (b.failed) {
+        fprintf(stderr, "a map stopped loading part way through, the results are incomplete\n");
+        return 1;
+    }
+
+    printf("%-24s %-10s %7s %8s %6s %8s %9s %7s %8s %5s %7s\n", "map", "bot", "games", "score", "best",
+           "length", "ticks", "food", "hungry", "won", "starved");
+    for (size_t m=0; m<b.maps.size(); m++)
+        for (size_t k=0; k<b.bots.size(); k++) {
+            results *r = &totals[m * numBots + b.bots[k]];
+            if (r->games == 0) continue;
+            double n = r->games;
+            const char *name = strrchr(b.maps[m].c_str(), '/');
+            name = name ? name + 1 : b.maps[m].c_str();
+            printf("%-24s %-10s %7ld %8.1f %6d %8.1f %9.1f %7.1f %8.1f %5ld %7ld\n", name, bots[b.bots[k]].name,
+                   r->games, r->score / n, r->best, r->length / n, r->ticks / n, r->food / n, r->hungry / n,
+                   r->wins, r->starved);
+        }
+    printf("%d games on %d threads in %.2f s, %.0f games per second\n", games, threads, elapsed.count(), games / elapsed.count());
+    return 0;
+}
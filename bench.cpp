@@ -0,0 +1,600 @@
+/* Eddy Gao                     Serpens - Benchmarks                         ICS3U
+Microbenchmarks for the pieces of the game loop that have to stay fast. The results
+are printed as JSON, so runs from different builds can be saved and compared.
+This does not need allegro, build it with:
+    g++ -O2 -pthread bench.cpp engine.cpp mapfile.cpp replay.cpp path.cpp snapshot.cpp arena.cpp cycle.cpp analyze.cpp mapgen.cpp pool.cpp benchtrace.cpp trace.cpp -o bench -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+The --wrap lets the benchmark count every allocation the game makes. Tracing is only
+turned on in benchtrace.cpp, so the rest of the game is timed the way it's normally built.
+The drawing is measured separately by benchrender.cpp, because that needs allegro.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <chrono>
+#include <algorithm>
+#include "snake.h"
+#include "engine.h"
+#include "mapfile.h"
+#include "replay.h"
+#include "path.h"
+#include "snapshot.h"
+#include "arena.h"
+#include "cycle.h"
+#include "analyze.h"
+#include "mapgen.h"
+#include "pool.h"
+
+//in benchtrace.cpp
+double benchTrace(double *clockCost);
+
+//allocations made since the program started, counted by the wrappers below
+long allocations = 0;
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    allocations++;
+    return __real_realloc(p, size);
+}
+}
+
+//so that C++ allocations get counted too
+void *operator new(size_t size) {
+    void *p = malloc(size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+//measures the cost of one tick of snake movement (remove the tail, add a head) at a given length
+double benchBody(int length) {
+    const int ticks = 10000000;
+    snake body;
+    sinit(&body, length + 1);
+    for (int i=0; i<length; i++) sappend(&body, i % 1024, i / 1024);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int checksum = 0;
+    for (int i=0; i<ticks; i++) {
+        segment leftover = spop(&body);
+        checksum += getElem(&body, 0)->x;
+        sappend(&body, leftover.x, leftover.y);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    //print the checksum so the loop isn't optimized away
+    if (checksum == -1) printf("%d\n", checksum);
+    sdestroy(&body);
+    return elapsed.count() / ticks;
+}
+
+//measures the cost of a whole tick of the game at a given length: moving the snake, checking
+//what it ran into and keeping the grid up to date. The snake runs along a row of the map
+//that food can't go on, so it never eats or dies and keeps the same length
+double benchTick(int length) {
+    const int ticks = 10000000;
+    engine e;
+    einit(&e);
+    setsize(&e, length + 16, 2);
+    for (int x=0; x<e.width; x++) setsquare(e.map, e.stride, x, 0, Infertile);
+    e.spawnx = e.spawny = 0;
+    newgame(&e, 1);
+    e.extend = length - 1;
+    for (int i=1; i<length; i++) step(&e, Right);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int checksum = 0;
+    for (int i=0; i<ticks; i++) checksum += step(&e, Right) + e.posx;
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (checksum == -1 || e.body.length != length) printf("%d\n", checksum);
+    edestroy(&e);
+    return elapsed.count() / ticks;
+}
+
+//measures a tick in nanoseconds on an empty map of the given size, using the code compiled for
+//that size if fixedSize is set and the code for any size if not. The snake turns at random and
+//starts again when it dies, which is timed on its own in restartCost (in microseconds) since
+//rebuilding the free square index takes longer than hundreds of ticks on the bigger maps.
+//checksum adds up the whole game so both can be checked to match
+double benchSized(int width, int height, bool fixedSize, double *restartCost, long *checksum) {
+    const int ticks = 2000000;
+    engine e;
+    rng r;
+    einit(&e);
+    setsize(&e, width, height);
+    pickstep(&e, fixedSize);
+    e.spawnx = width / 2;
+    e.spawny = height / 2;
+    newgame(&e, 1);
+    rngseed(&r, 2);
+    *checksum = 0;
+
+    std::chrono::steady_clock::duration restarting(0);
+    int restarts = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<ticks; i++) {
+        //a quarter of the numbers are directions, the rest carry on straight
+        int events = step(&e, rngrange(&r, 16));
+        *checksum += events + e.posx * 31 + e.posy;
+        if (events & (Died | Won)) {
+            std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+            newgame(&e, e.seed + 1);
+            restarting += std::chrono::steady_clock::now() - before;
+            restarts++;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start - restarting;
+    *restartCost = restarts > 0 ? std::chrono::duration<double, std::micro>(restarting).count() / restarts : 0;
+    edestroy(&e);
+    return elapsed.count() / ticks;
+}
+
+//measures the cost of placing food when a given fraction of the board is already taken,
+//the food is taken off again each time so the board stays just as full
+double benchFood(double fill) {
+    const int calls = 10000000;
+    engine e;
+    rng r;
+    einit(&e);
+    setsize(&e, 512, 512);
+    rngseed(&r, 1);
+    for (int y=0; y<e.height; y++)
+        for (int x=0; x<e.width; x++) {
+            if (rngrange(&r, 1000) < fill * 1000) setsquare(e.map, e.stride, x, y, Snake);
+        }
+    e.spawnx = e.spawny = 0;
+    setsquare(e.map, e.stride, 0, 0, Empty);
+    newgame(&e, 1);
+    setgrid(&e, e.foodx, e.foody, Empty);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long checksum = 0;
+    for (int i=0; i<calls; i++) {
+        placefood(&e);
+        checksum += e.foodx;
+        setgrid(&e, e.foodx, e.foody, Empty);
+        if (e.specx != -1) {
+            setgrid(&e, e.specx, e.specy, Empty);
+            e.specx = e.specy = -1;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (checksum == -1) printf("%ld\n", checksum);
+    edestroy(&e);
+    return elapsed.count() / calls;
+}
+
+//measures how many ticks per second the engine can run, without any drawing
+double benchEngine() {
+    const int ticks = 20000000;
+    engine e;
+    einit(&e);
+    newgame(&e, 1);
+
+    int games = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<ticks; i++) {
+        if (step(&e, greedy(&e)) & (Died | Won)) {
+            newgame(&e, e.seed + 1);
+            games++;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (games == -1) printf("%d\n", games);
+    edestroy(&e);
+    return ticks / elapsed.count();
+}
+
+//measures how long the autopilot takes to decide on a move, in microseconds, on a map of the
+//given size with some walls scattered around. Also gives the average score it gets
+double benchAutopilot(int width, int height, double *score) {
+    const int ticks = width * height > 10000 ? 2000 : 200000;
+    engine e;
+    pathfinder p;
+    rng r;
+    einit(&e);
+    pinit(&p);
+    setsize(&e, width, height);
+    rngseed(&r, 1);
+    for (int y=0; y<height; y++)
+        for (int x=0; x<width; x++) {
+            if (rngrange(&r, 20) == 0) setsquare(e.map, e.stride, x, y, Snake);
+        }
+    e.spawnx = e.spawny = 0;
+    setsquare(e.map, e.stride, 0, 0, Empty);
+    newgame(&e, 1);
+
+    int games = 0;
+    long total = 0;
+    std::chrono::duration<double, std::micro> searching(0);
+    for (int i=0; i<ticks; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int direction = steer(&p, &e);
+        searching += std::chrono::steady_clock::now() - start;
+        if (step(&e, direction) & (Died | Won)) {
+            total += e.score;
+            games++;
+            newgame(&e, e.seed + 1);
+        }
+    }
+    //count the game in progress too, in case it never ended
+    *score = (double)(total + e.score) / (games + 1);
+    pdestroy(&p);
+    edestroy(&e);
+    return searching.count() / ticks;
+}
+
+//records a game of the greedy bot, then measures how many times faster than real time
+//it plays back. Also checks the replay ends the same way, or it isn't deterministic
+double benchReplay(bool *same) {
+    const int plays = 1000;
+    engine e;
+    replay r;
+    einit(&e);
+    rinit(&r);
+    rstart(&r, "default.txt", 12345);
+    newgame(&e, r.seed);
+    int events = 0;
+    while (!(events & (Died | Won))) {
+        int direction = greedy(&e);
+        if (canturn(&e, direction)) rrecord(&r, e.tick, direction);
+        events = step(&e, direction);
+    }
+    r.length = e.tick;
+    int score = e.score;
+    rsave(&r, "bench_replay.srep");
+    rdestroy(&r);
+
+    //play back from the file, as if a player had sent it in
+    rload(&r, "bench_replay.srep");
+    *same = true;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<plays; i++) {
+        newgame(&e, r.seed);
+        rrewind(&r);
+        rplay(&e, &r, r.length);
+        if (e.score != score || e.tick != r.length) *same = false;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    //the game normally runs at 10 ticks per second
+    double realtime = r.length * plays / 10.0;
+    rdestroy(&r);
+    edestroy(&e);
+    remove("bench_replay.srep");
+    return realtime / elapsed.count();
+}
+
+//measures how fast a map file can be loaded into the engine, in megabytes of file per second
+//and millions of squares per second (binary maps are much smaller, so both matter). Loading
+//also sets the engine up for the map, so parseRate is readmap() on its own in megabytes per second
+double benchLoader(const char *path, double *squares, double *parseRate) {
+    const int loads = 10;
+    engine e;
+    einit(&e);
+    FILE *f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    double megabytes = ftell(f) / 1e6;
+    fclose(f);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<loads; i++) {
+        mapdata m;
+        if (readmap(&m, path)) freemap(&m);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    *parseRate = megabytes * loads / elapsed.count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i=0; i<loads; i++) loadMap(&e, path);
+    elapsed = std::chrono::steady_clock::now() - start;
+    *squares = (double)e.width * e.height * loads / elapsed.count() / 1e6;
+    edestroy(&e);
+    return megabytes * loads / elapsed.count();
+}
+
+//measures copying a game part way through to another engine and back, in nanoseconds, and
+//saving it to a file and loading it again, in microseconds. Checks that both carry on the same way
+double benchSnapshot(double *fileCost, bool *same) {
+    const int copies = 1000000, files = 2000;
+    engine e, saved, branch;
+    einit(&e);
+    einit(&saved);
+    einit(&branch);
+    loadMap(&e, "maps/default.txt");
+    newgame(&e, 1);
+    for (int i=0; i<200; i++) step(&e, greedy(&e));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<copies; i++) {
+        ecopy(&saved, &e);
+        ecopy(&e, &saved);
+    }
+    std::chrono::duration<double, std::nano> copying = std::chrono::steady_clock::now() - start;
+
+    char map[maxSnapshotName+1];
+    int color[3] = {0, 0, 0};
+    start = std::chrono::steady_clock::now();
+    for (int i=0; i<files; i++) {
+        savesnapshot("bench_snapshot.ssav", &e, "default.txt", color);
+        loadsnapshot("bench_snapshot.ssav", &branch, map, color);
+    }
+    std::chrono::duration<double, std::micro> filing = std::chrono::steady_clock::now() - start;
+    remove("bench_snapshot.ssav");
+
+    //all three have to play out the same
+    *same = true;
+    for (int i=0; i<1000; i++) {
+        int events = step(&e, greedy(&e));
+        step(&saved, greedy(&saved));
+        step(&branch, greedy(&branch));
+        if (saved.score != e.score || branch.score != e.score || saved.posx != e.posx || branch.posx != e.posx) *same = false;
+        if (events & (Died | Won)) break;
+    }
+
+    edestroy(&branch);
+    edestroy(&saved);
+    edestroy(&e);
+    *fileCost = filing.count() / files;
+    return copying.count() / (copies * 2);
+}
+
+//measures an arena tick with the given number of snakes, in nanoseconds, including the bots
+//deciding where to go. A new game starts whenever one is over
+double benchArena(int snakes) {
+    const int ticks = 2000000;
+    arena a;
+    ainit(&a);
+    setsize(&a.board, 64, 64);
+    anewgame(&a, snakes, 1);
+    int directions[maxSnakes];
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<ticks; i++) {
+        for (int p=0; p<snakes; p++) directions[p] = a.players[p].alive ? abot(&a, p) : None;
+        astep(&a, directions);
+        if (a.alive <= (snakes > 1 ? 1 : 0)) anewgame(&a, snakes, a.board.seed + 1);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    adestroy(&a);
+    return elapsed.count() / ticks;
+}
+
+//measures finding a map's cycle in milliseconds, and reading it back from its file in microseconds.
+//The demo then plays a game on it, to check it fills the board and see how many ticks that takes
+double benchCycle(const char *path, double *cacheCost, int *fillTicks, bool *filled) {
+    const int loads = 100;
+    engine e;
+    hamcycle h;
+    einit(&e);
+    hinit(&h);
+    *cacheCost = *fillTicks = 0;
+    *filled = false;
+    if (!loadMap(&e, path)) {
+        edestroy(&e);
+        return -1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int status = hfind(&h, &e, cycleBudget);
+    std::chrono::duration<double, std::milli> finding = std::chrono::steady_clock::now() - start;
+
+    hsave(&h, "bench_cycle.cyc");
+    start = std::chrono::steady_clock::now();
+    for (int i=0; i<loads; i++) hload(&h, "bench_cycle.cyc", &e);
+    std::chrono::duration<double, std::micro> loading = std::chrono::steady_clock::now() - start;
+    *cacheCost = loading.count() / loads;
+    remove("bench_cycle.cyc");
+
+    if (status == CycleFound) {
+        newgame(&e, 1);
+        int events = 0;
+        while (!(events & (Died | Won))) events = step(&e, hsteer(&h, &e));
+        *fillTicks = e.tick;
+        *filled = events & Won;
+    }
+    hdestroy(&h);
+    edestroy(&e);
+    return finding.count();
+}
+
+//measures checking a 1024x1024 map with analyzemap in milliseconds, with one square in
+//wallChance a wall. Lots of walls means lots of short runs, which is the slow case
+double benchAnalyze(int wallChance) {
+    const int size = 1024, checks = 20;
+    rng r;
+    mapdata m;
+    mapreport report;
+    rngseed(&r, 1);
+    allocmap(&m, size, size);
+    for (long i=0; i<(long)size*size; i++) m.tiles[i] = rngrange(&r, wallChance) == 0 ? MapWall : MapEmpty;
+    m.tiles[0] = MapSpawn;
+    //the first check allocates what the analyzer keeps between checks
+    analyzemap(&report, m.tiles, size, size, 0, 0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<checks; i++) analyzemap(&report, m.tiles, size, size, 0, 0);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    freemap(&m);
+    return elapsed.count() / checks;
+}
+
+//measures making a 4096x4096 map of the given style on every core, in milliseconds
+double benchGenerate(int style) {
+    mapdata m;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    genmap(&m, style, 4096, 4096, 1, numcores());
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    freemap(&m);
+    return elapsed.count();
+}
+
+//counts the allocations per tick of a game, once everything has been set up. The bots are
+//included since the autopilot and recording a replay both run every tick in the game
+void benchAllocs(double *engineAllocs, double *autopilotAllocs, double *replayAllocs) {
+    const int ticks = 1000000;
+    engine e;
+    pathfinder p;
+    replay r;
+    einit(&e);
+    pinit(&p);
+    rinit(&r);
+    loadMap(&e, "maps/default.txt");
+    newgame(&e, 1);
+    steer(&p, &e);
+    rstart(&r, "default.txt", 1);
+
+    long before = allocations;
+    for (int i=0; i<ticks; i++) {
+        if (step(&e, greedy(&e)) & (Died | Won)) newgame(&e, e.seed + 1);
+    }
+    *engineAllocs = (double)(allocations - before) / ticks;
+
+    before = allocations;
+    for (int i=0; i<ticks; i++) {
+        if (step(&e, steer(&p, &e)) & (Died | Won)) newgame(&e, e.seed + 1);
+    }
+    *autopilotAllocs = (double)(allocations - before) / ticks;
+
+    before = allocations;
+    for (int i=0; i<ticks; i++) {
+        int direction = greedy(&e);
+        if (canturn(&e, direction)) rrecord(&r, e.tick, direction);
+        if (step(&e, direction) & (Died | Won)) newgame(&e, e.seed + 1);
+    }
+    *replayAllocs = (double)(allocations - before) / ticks;
+
+    rdestroy(&r);
+    pdestroy(&p);
+    edestroy(&e);
+}
+
+int main() {
+    printf("{\n");
+    int lengths[] = {16, 256, 4096, 65536, 1048576};
+    printf("  \"body_ns_per_tick\": {");
+    for (int i=0; i<5; i++) printf("%s\"%d\": %.2f", i ? ", " : "", lengths[i], benchBody(lengths[i]));
+    printf("},\n");
+    printf("  \"tick_ns\": {");
+    for (int i=0; i<5; i++) printf("%s\"%d\": %.2f", i ? ", " : "", lengths[i], benchTick(lengths[i]));
+    printf("},\n");
+
+    double fills[] = {0, 0.5, 0.9, 0.99};
+    int stock[5][2] = {{defaultWidth, defaultHeight}, {32, 32}, {64, 64}, {128, 128}, {256, 256}};
+    printf("  \"tick_ns_by_size\": {");
+    for (int i=0; i<5; i++) {
+        //the difference is small next to the noise, so this is the median of a lot of short runs,
+        //taking turns at going first
+        const int runs = 9;
+        double fixed[runs], generic[runs], fixedRestart[runs], genericRestart[runs];
+        long fixedSum, genericSum;
+        for (int run=0; run<runs; run++) {
+            if (run % 2) generic[run] = benchSized(stock[i][0], stock[i][1], false, &genericRestart[run], &genericSum);
+            fixed[run] = benchSized(stock[i][0], stock[i][1], true, &fixedRestart[run], &fixedSum);
+            if (run % 2 == 0) generic[run] = benchSized(stock[i][0], stock[i][1], false, &genericRestart[run], &genericSum);
+        }
+        std::sort(fixed, fixed + runs);
+        std::sort(generic, generic + runs);
+        std::sort(fixedRestart, fixedRestart + runs);
+        std::sort(genericRestart, genericRestart + runs);
+        printf("%s\"%dx%d\": {\"fixed\": %.2f, \"generic\": %.2f, \"restart_fixed_us\": %.2f, \"restart_generic_us\": %.2f, \"same\": %s}",
+               i ? ", " : "", stock[i][0], stock[i][1], fixed[runs / 2], generic[runs / 2], fixedRestart[runs / 2], genericRestart[runs / 2],
+               fixedSum == genericSum ? "true" : "false");
+    }
+    printf("},\n");
+
+    printf("  \"placefood_ns\": {");
+    for (int i=0; i<4; i++) printf("%s\"%.2f\": %.2f", i ? ", " : "", fills[i], benchFood(fills[i]));
+    printf("},\n");
+
+    printf("  \"engine_ticks_per_second\": %.0f,\n", benchEngine());
+    int sizes[][2] = {{24, 30}, {256, 256}, {1024, 1024}};
+    printf("  \"autopilot\": {");
+    for (int i=0; i<3; i++) {
+        double score, cost = benchAutopilot(sizes[i][0], sizes[i][1], &score);
+        printf("%s\"%dx%d\": {\"us_per_tick\": %.2f, \"score\": %.0f}", i ? ", " : "", sizes[i][0], sizes[i][1], cost, score);
+    }
+    printf("},\n");
+    bool same;
+    double speedup = benchReplay(&same);
+    printf("  \"replay\": {\"times_real_time\": %.0f, \"deterministic\": %s},\n", speedup, same ? "true" : "false");
+
+    //a big map, with walls scattered around so it doesn't compress too well
+    mapdata m;
+    rng r;
+    allocmap(&m, 4096, 4096);
+    rngseed(&r, 1);
+    for (long i=0; i<4096L*4096; i++) m.tiles[i] = rngrange(&r, 20) == 0 ? MapWall : MapEmpty;
+    m.spawnx = m.spawny = 0;
+    m.tiles[0] = MapSpawn;
+    writemap(&m, "bench_map.txt");
+    writemap(&m, "bench_map.smap");
+    freemap(&m);
+    double squares, rate, parseRate;
+    rate = benchLoader("bench_map.txt", &squares, &parseRate);
+    printf("  \"loadmap_text\": {\"mb_per_second\": %.0f, \"msquares_per_second\": %.0f, \"readmap_mb_per_second\": %.0f},\n", rate, squares, parseRate);
+    rate = benchLoader("bench_map.smap", &squares, &parseRate);
+    printf("  \"loadmap_binary\": {\"mb_per_second\": %.0f, \"msquares_per_second\": %.0f, \"readmap_mb_per_second\": %.0f},\n", rate, squares, parseRate);
+    remove("bench_map.txt");
+    remove("bench_map.smap");
+
+    int counts[] = {1, 2, 4, 8};
+    printf("  \"arena_ns_per_tick\": {");
+    for (int i=0; i<4; i++) printf("%s\"%d\": %.1f", i ? ", " : "", counts[i], benchArena(counts[i]));
+    printf("},\n");
+
+    const char *cycleMaps[] = {"default.txt", "grid.txt", "labyrinth.txt", "maze.txt"};
+    printf("  \"cycle\": {");
+    for (int i=0; i<4; i++) {
+        char path[64];
+        double cacheCost;
+        int fillTicks;
+        bool filled;
+        snprintf(path, sizeof(path), "maps/%s", cycleMaps[i]);
+        double cost = benchCycle(path, &cacheCost, &fillTicks, &filled);
+        printf("%s\"%s\": {\"find_ms\": %.2f, \"cache_us\": %.1f, \"demo_ticks\": %d, \"filled\": %s}", i ? ", " : "",
+               cycleMaps[i], cost, cacheCost, fillTicks, filled ? "true" : "false");
+    }
+    printf("},\n");
+
+    printf("  \"analyze_ms_1m\": {\"sparse\": %.2f, \"noise\": %.2f},\n", benchAnalyze(20), benchAnalyze(5));
+
+    printf("  \"genmap_ms_4096\": {");
+    for (int i=0; i<numStyles; i++) printf("%s\"%s\": %.1f", i ? ", " : "", stylename(i), benchGenerate(i));
+    printf("},\n");
+
+    double fileCost, copyCost = benchSnapshot(&fileCost, &same);
+    printf("  \"snapshot\": {\"copy_ns\": %.0f, \"file_us\": %.1f, \"deterministic\": %s},\n", copyCost, fileCost, same ? "true" : "false");
+
+    double clockCost, scopeCost = benchTrace(&clockCost);
+    printf("  \"trace_ns_per_scope\": %.2f,\n", scopeCost);
+    printf("  \"trace_clock_ns\": %.2f,\n", clockCost);
+
+    double engineAllocs, autopilotAllocs, replayAllocs;
+    benchAllocs(&engineAllocs, &autopilotAllocs, &replayAllocs);
+    printf("  \"allocations_per_tick\": {\"engine\": %.6f, \"autopilot\": %.6f, \"replay\": %.6f}\n", engineAllocs, autopilotAllocs, replayAllocs);
+    printf("}\n");
+    return 0;
+}
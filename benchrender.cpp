@@ -0,0 +1,89 @@
+/* Eddy Gao                     Serpens - Drawing benchmarks                 ICS3U
+Measures how long drawing a frame takes, in the normal and fancy centred view modes.
+Everything is drawn to bitmaps in memory, so no window is opened and the results
+don't depend on the video card. The results are printed as JSON, like bench.cpp.
+Build it with:
+    g++ -O2 benchrender.cpp render.cpp engine.cpp mapfile.cpp path.cpp -o benchrender -lalleg
+*/
+#include <allegro.h>
+#include <stdio.h>
+#include <chrono>
+#include "engine.h"
+#include "path.h"
+#include "render.h"
+
+//measures drawing the whole view from scratch and copying it to target, in microseconds per frame
+double benchFrame(BITMAP *target) {
+    const int frames = 2000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<frames; i++) {
+        redrawview();
+        present(target);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+//measures a tick the way the game draws it: only what changed, plus scrolling when the camera
+//moves. Includes the tick itself, in microseconds per tick
+double benchTicks(engine *e, BITMAP *target) {
+    const int ticks = 100000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<ticks; i++) {
+        int events = step(e, greedy(e));
+        if (events & (Died | Won)) {
+            newgame(e, e->seed + 1);
+            layout(e);
+        } else drawevents(e, events);
+        present(target);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ticks;
+}
+
+int main(int argc, char **argv) {
+    const char *maps[] = {"maps/default.txt", "maps/labyrinth.txt"};
+    allegro_init();
+    set_color_depth(32);
+    buffer = create_bitmap(scrx, scry-40);
+    atlas = create_bitmap(atlasWidth, atlasHeight);
+    BITMAP *target = create_bitmap(scrx, scry-40);
+    color[0] = 40;
+    color[1] = 90;
+    color[2] = 60;
+    makeatlas();
+
+    engine e;
+    einit(&e);
+    printf("{\n");
+    for (int i=0; i<2; i++) {
+        if (!loadMap(&e, maps[i])) {
+            fprintf(stderr, "could not load %s\n", maps[i]);
+            return 1;
+        }
+        printf("  \"%s\": {", maps[i]);
+        for (int mode=0; mode<2; mode++) {
+            fancy = mode == 1;
+            newgame(&e, 1);
+            layout(&e);
+            //grow the snake a bit so there's something to draw
+            for (int t=0; t<200; t++) {
+                int events = step(&e, greedy(&e));
+                if (events & (Died | Won)) break;
+                drawevents(&e, events);
+            }
+            double frame = benchFrame(target);
+            double tick = benchTicks(&e, target);
+            printf("%s\"%s\": {\"full_frame_us\": %.2f, \"tick_us\": %.2f}", mode ? ", " : "", fancy ? "fancy" : "normal", frame, tick);
+        }
+        printf("}%s\n", i < 1 ? "," : "");
+    }
+    printf("}\n");
+
+    edestroy(&e);
+    destroy_bitmap(target);
+    destroy_bitmap(atlas);
+    destroy_bitmap(buffer);
+    return 0;
+}
+END_OF_MAIN()
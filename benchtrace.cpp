@@ -0,0 +1,42 @@
+/* Eddy Gao                     Serpens - Trace benchmark                    ICS3U
+Times a TRACE scope for bench.cpp. It's in a file of its own because it's built with
+tracing on, and the rest of the benchmark has to be built without it.
+*/
+#define SERPENS_TRACE
+#include <stdio.h>
+#include <chrono>
+#include "trace.h"
+
+//measures one TRACE scope in nanoseconds, with next to nothing in it. clockCost is what just
+//reading the time twice costs, which is most of a scope, so the rest of it can be told apart.
+//Both are the best of a few runs since they're so short
+double benchTrace(double *clockCost) {
+    const int scopes = 10000000, runs = 3;
+    long checksum = 0;
+    //the first scope makes the thread's buffer, which shouldn't be timed
+    {
+        TRACE("warmup");
+    }
+    double best = 0;
+    *clockCost = 0;
+    for (int r=0; r<runs; r++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i=0; i<scopes; i++) {
+            TRACE("benchTrace");
+            checksum += i;
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() / scopes < best) best = elapsed.count() / scopes;
+
+        start = std::chrono::steady_clock::now();
+        for (int i=0; i<scopes; i++) {
+            uint64_t begin = tracenow();
+            checksum += tracenow() - begin;
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() / scopes < *clockCost) *clockCost = elapsed.count() / scopes;
+    }
+
+    if (checksum == -1) printf("%ld\n", checksum);
+    return best;
+}
@@ -0,0 +1,765 @@
+/* Eddy Gao                     Serpens - Cycles                             ICS3U
+Finding, saving and following Hamiltonian cycles. See cycle.h.
+
+Before searching, the map is checked for the things that rule a loop out: a square
+with only one open neighbour, the map being in pieces, a square that's the only way
+between two parts of it, and (when the width and height are both even, so the squares
+are coloured like a chessboard even across the edges) more squares of one colour than
+the other, since the loop has to alternate.
+The search itself is a depth first search that always tries the neighbour with the
+fewest ways out first. It keeps count of how many ways out every unvisited square has
+left and backs off as soon as one is down to one, and only floods the unvisited squares
+to see if they've been cut in two when the square just taken could have done it.
+
+Cycle files are laid out like this, every number is little endian:
+    "SCYC"              magic
+    version             always 1, 32 bits
+    hash                64 bits, maphash() of the map the file is for
+    width, height, status
+                        32 bits each
+    reason              one byte for the length, then the text
+    length              32 bits, the number of squares in the loop, 0 if there isn't one
+    start               32 bits each for the x and y of the first square
+    loop                2 bits for every other square, the direction (minus one) from
+                        the square before it, 4 to a byte, lowest bits first
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "cycle.h"
+#include "trace.h"
+
+//how many steps the search takes before it first starts over
+const long firstRestart = 2000;
+
+//set to make a search on the background thread give up early
+static std::atomic<bool> stopping(false);
+
+void hinit(hamcycle *h) {
+    h->width = h->height = h->length = 0;
+    h->squares = h->order = NULL;
+    h->hash = 0;
+    h->status = CycleGaveUp;
+    h->reason[0] = '\0';
+}
+
+void hdestroy(hamcycle *h) {
+    free(h->squares);
+    free(h->order);
+    hinit(h);
+}
+
+//makes room for a loop through a map of this size, with no squares in it yet
+static bool hsize(hamcycle *h, int width, int height) {
+    long squares = (long)width * height;
+    if ((long)h->width * h->height != squares || h->order == NULL) {
+        free(h->squares);
+        free(h->order);
+        h->squares = (int*)malloc(sizeof(int) * squares);
+        h->order = (int*)malloc(sizeof(int) * squares);
+        if (h->squares == NULL || h->order == NULL) {
+            hdestroy(h);
+            return false;
+        }
+    }
+    h->width = width;
+    h->height = height;
+    h->length = 0;
+    for (long c=0; c<squares; c++) h->order[c] = -1;
+    return true;
+}
+
+//a 64 bit FNV-1a hash of the map's size and walls, to tell if a cycle file is still for the same map
+uint64_t maphash(engine *e) {
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t values[2] = {(uint64_t)e->width, (uint64_t)e->height};
+    for (int i=0; i<2; i++)
+        for (int b=0; b<64; b+=8) hash = (hash ^ ((values[i] >> b) & 255)) * 1099511628211ULL;
+    for (long i=0; i<(long)e->stride * e->height; i++)
+        for (int b=0; b<64; b+=8) hash = (hash ^ ((e->map[i] >> b) & 255)) * 1099511628211ULL;
+    return hash;
+}
+
+//the squares next to c in each direction (minus one), going round the edges
+static void around(int width, int height, int c, int *next) {
+    int x = c % width, y = c / width;
+    next[Up - 1] = (y > 0 ? y - 1 : height - 1) * width + x;
+    next[Down - 1] = (y < height - 1 ? y + 1 : 0) * width + x;
+    next[Left - 1] = y * width + (x > 0 ? x - 1 : width - 1);
+    next[Right - 1] = y * width + (x < width - 1 ? x + 1 : 0);
+}
+
+//the open squares of the map and how they join up
+typedef struct graph {
+    int width, height, squares, open;
+    //up to 4 open neighbours for every square, each one only once, and how many there are
+    int *adj, *deg;
+    bool bipartite;
+} graph;
+
+static bool makegraph(graph *g, engine *e) {
+    g->width = e->width;
+    g->height = e->height;
+    g->squares = e->width * e->height;
+    g->open = 0;
+    //a loop always has an even length when the colours of the squares alternate all the way round
+    g->bipartite = e->width % 2 == 0 && e->height % 2 == 0;
+    g->adj = (int*)malloc(sizeof(int) * 4 * g->squares);
+    g->deg = (int*)malloc(sizeof(int) * g->squares);
+    if (g->adj == NULL || g->deg == NULL) return false;
+    for (int c=0; c<g->squares; c++) {
+        g->deg[c] = 0;
+        if (getmap(e, c % g->width, c / g->width) == Snake) continue;
+        g->open++;
+        int next[4];
+        around(g->width, g->height, c, next);
+        for (int d=0; d<4; d++) {
+            bool seen = next[d] == c || getmap(e, next[d] % g->width, next[d] / g->width) == Snake;
+            for (int k=0; k<g->deg[c] && !seen; k++) seen = g->adj[c*4 + k] == next[d];
+            if (!seen) g->adj[c*4 + g->deg[c]++] = next[d];
+        }
+    }
+    return true;
+}
+
+static void freegraph(graph *g) {
+    free(g->adj);
+    free(g->deg);
+}
+
+static bool isopen(engine *e, int c) {
+    return getmap(e, c % e->width, c / e->width) != Snake;
+}
+
+//looks for something about the map that means there can't be a loop, and puts it in reason
+static bool ruledout(graph *g, engine *e, char *reason, int size) {
+    int first = -1;
+    for (int c=0; c<g->squares && first == -1; c++) if (isopen(e, c)) first = c;
+    if (g->open < 3) {
+        snprintf(reason, size, "the map only has %d open square%s", g->open, g->open == 1 ? "" : "s");
+        return true;
+    }
+    for (int c=0; c<g->squares; c++) {
+        if (isopen(e, c) && g->deg[c] < 2) {
+            snprintf(reason, size, "square (%d, %d) has %s way in or out", c % g->width, c / g->width, g->deg[c] ? "only one" : "no");
+            return true;
+        }
+    }
+
+    //depth first from the first open square, finding how many it reaches and any square that
+    //is the only way between two parts of the map (with the usual lowest reachable number)
+    int *number = (int*)malloc(sizeof(int) * g->squares), *low = (int*)malloc(sizeof(int) * g->squares);
+    int *parent = (int*)malloc(sizeof(int) * g->squares), *tried = (int*)malloc(sizeof(int) * g->squares);
+    int *stack = (int*)malloc(sizeof(int) * g->squares);
+    if (number == NULL || low == NULL || parent == NULL || tried == NULL || stack == NULL) {
+        //the search will have to find out the slow way
+        free(number), free(low), free(parent), free(tried), free(stack);
+        return false;
+    }
+    for (int c=0; c<g->squares; c++) number[c] = -1;
+    int count = 0, depth = 0, children = 0, cut = -1;
+    number[first] = low[first] = count++;
+    parent[first] = -1;
+    tried[first] = 0;
+    stack[depth++] = first;
+    while (depth > 0) {
+        int v = stack[depth-1];
+        if (tried[v] < g->deg[v]) {
+            int u = g->adj[v*4 + tried[v]++];
+            if (number[u] == -1) {
+                number[u] = low[u] = count++;
+                parent[u] = v;
+                tried[u] = 0;
+                stack[depth++] = u;
+                if (v == first) children++;
+            } else if (u != parent[v] && number[u] < low[v]) low[v] = number[u];
+            continue;
+        }
+        depth--;
+        int p = parent[v];
+        if (p == -1) continue;
+        if (low[v] < low[p]) low[p] = low[v];
+        if (p != first && low[v] >= number[p] && cut == -1) cut = p;
+    }
+    if (children > 1) cut = first;
+    free(number), free(low), free(parent), free(tried), free(stack);
+
+    if (count < g->open) {
+        snprintf(reason, size, "%d of the %d open squares can't be reached from the rest", g->open - count, g->open);
+        return true;
+    }
+    if (cut != -1) {
+        snprintf(reason, size, "square (%d, %d) is the only way between two parts of the map", cut % g->width, cut / g->width);
+        return true;
+    }
+    if (g->bipartite) {
+        int colours[2] = {0, 0};
+        for (int c=0; c<g->squares; c++) if (isopen(e, c)) colours[(c % g->width + c / g->width) & 1]++;
+        if (colours[0] != colours[1]) {
+            snprintf(reason, size, "it has %d more %s squares than %s ones and the loop has to alternate",
+                     abs(colours[0] - colours[1]), colours[0] > colours[1] ? "even" : "odd", colours[0] > colours[1] ? "odd" : "even");
+            return true;
+        }
+    }
+    return false;
+}
+
+//the direction (minus one) that goes back the other way
+static int reverse(int d) {
+    return d ^ 1;
+}
+
+//builds the loop straight away when the map splits into 2x2 blocks that are all open or all
+//wall (which open maps with an even width and height do). A loop goes round each block, and
+//two loops next to each other join into one by swapping the edges down the side they share,
+//so joining the blocks along a spanning tree leaves one loop through everything
+static bool blocks(hamcycle *h, graph *g, engine *e) {
+    if (g->width % 2 != 0 || g->height % 2 != 0) return false;
+    int across = g->width / 2, down = g->height / 2;
+    //the blocks can start on an odd row or column, the edges wrap round anyway
+    int ox = 0, oy = 0;
+    bool aligned = false;
+    for (int o=0; o<4 && !aligned; o++) {
+        ox = o & 1;
+        oy = o >> 1;
+        aligned = true;
+        for (int b=0; b<across*down && aligned; b++) {
+            int x = ox + (b % across) * 2, y = oy + (b / across) * 2;
+            bool open = isopen(e, y * g->width + x);
+            for (int k=1; k<4 && aligned; k++) {
+                int c = (y + k / 2) % g->height * g->width + (x + k % 2) % g->width;
+                aligned = isopen(e, c) == open;
+            }
+        }
+    }
+    if (!aligned) return false;
+
+    //which ways each square's loop goes, a bit for each direction (minus one). The top left
+    //square of a block starts off going right and down, and so on round the block
+    unsigned char *links = (unsigned char*)calloc(g->squares, 1);
+    int *tree = (int*)malloc(sizeof(int) * (size_t)across * down);
+    bool *joined = (bool*)calloc((size_t)across * down, sizeof(bool));
+    if (links == NULL || tree == NULL || joined == NULL) {
+        free(links), free(tree), free(joined);
+        return false;
+    }
+    static const int corners[4] = {(1 << (Right-1)) | (1 << (Down-1)), (1 << (Left-1)) | (1 << (Down-1)),
+                                   (1 << (Right-1)) | (1 << (Up-1)), (1 << (Left-1)) | (1 << (Up-1))};
+    //the square in corner k (top left, top right, bottom left, bottom right) of block b
+    #define CORNER(b, k) (((oy + (b) / across * 2 + (k) / 2) % g->height) * g->width + (ox + (b) % across * 2 + (k) % 2) % g->width)
+    int first = -1;
+    for (int b=0; b<across*down; b++) {
+        if (!isopen(e, CORNER(b, 0))) continue;
+        if (first == -1) first = b;
+        for (int k=0; k<4; k++) links[CORNER(b, k)] = corners[k];
+    }
+
+    //grow a spanning tree of the open blocks from the first one, joining each block on as it's reached.
+    //Joining across a side takes away the two edges along it and puts in the two across it
+    int head = 0, tail = 0;
+    tree[tail++] = first;
+    joined[first] = true;
+    while (head < tail) {
+        int b = tree[head++], bx = b % across, by = b / across;
+        int next[4] = {(by + down - 1) % down * across + bx, (by + 1) % down * across + bx,
+                       by * across + (bx + across - 1) % across, by * across + (bx + 1) % across};
+        //the two corners of this block along each side, and the direction that runs along it
+        static const int side[4][2] = {{0, 1}, {2, 3}, {0, 2}, {1, 3}};
+        static const int along[4] = {Right-1, Right-1, Down-1, Down-1};
+        for (int d=0; d<4; d++) {
+            int n = next[d];
+            if (n == b || joined[n] || !isopen(e, CORNER(n, 0))) continue;
+            joined[n] = true;
+            tree[tail++] = n;
+            int o = reverse(d);
+            links[CORNER(b, side[d][0])] &= ~(1 << along[d]);
+            links[CORNER(b, side[d][1])] &= ~(1 << reverse(along[d]));
+            links[CORNER(n, side[o][0])] &= ~(1 << along[d]);
+            links[CORNER(n, side[o][1])] &= ~(1 << reverse(along[d]));
+            for (int k=0; k<2; k++) {
+                links[CORNER(b, side[d][k])] |= 1 << d;
+                links[CORNER(n, side[o][k])] |= 1 << o;
+            }
+        }
+    }
+    #undef CORNER
+
+    //walk round the loop from the first open square
+    int start = -1, c, from = -1, length = 0;
+    for (int i=0; i<g->squares && start == -1; i++) if (isopen(e, i)) start = i;
+    c = start;
+    bool ok = tail * 4 == g->open;
+    while (ok) {
+        int d = 0;
+        while (d < 4 && (!(links[c] & (1 << d)) || d == from)) d++;
+        ok = d < 4 && h->order[c] == -1;
+        if (!ok) break;
+        h->order[c] = length;
+        h->squares[length++] = c;
+        int next[4];
+        around(g->width, g->height, c, next);
+        c = next[d];
+        from = reverse(d);
+        if (c == start) break;
+    }
+    ok = ok && length == g->open;
+    if (ok) h->length = length;
+    else for (int i=0; i<g->squares; i++) h->order[i] = -1;
+    free(links), free(tree), free(joined);
+    return ok;
+}
+
+//everything the search keeps track of
+typedef struct search {
+    graph *g;
+    //the path so far, path[0] is where it started and the loop has to get back to
+    int *path, depth, start, left;
+    bool *visited;
+    //for every unvisited square, how many of its neighbours are unvisited, the head or the start
+    int *ways;
+    //how many unvisited squares the start still has next to it, and of each colour there are left
+    int startWays, colours[2];
+    //the neighbours to try next at every depth, best first, and how many have been tried
+    int *choices, *numChoices, *tried;
+    //for flooding the unvisited squares, squares are marked with the flood's number
+    int *queue, *mark, flood;
+    //breaks ties between equally good neighbours, differently every time the search starts over
+    rng random;
+} search;
+
+static int colour(graph *g, int c) {
+    return (c % g->width + c / g->width) & 1;
+}
+
+static bool nextto(graph *g, int a, int b) {
+    for (int k=0; k<g->deg[a]; k++) if (g->adj[a*4 + k] == b) return true;
+    return false;
+}
+
+//whether taking square c could have split the unvisited squares in two. If the unvisited squares
+//around it (diagonals too) join up all its unvisited neighbours, they're still joined without it
+static bool mightsplit(search *s, int c) {
+    graph *g = s->g;
+    if (g->width < 3 || g->height < 3) return true;
+    int x = c % g->width, y = c / g->width;
+    int left = x > 0 ? x - 1 : g->width - 1, right = x < g->width - 1 ? x + 1 : 0;
+    int up = y > 0 ? y - 1 : g->height - 1, down = y < g->height - 1 ? y + 1 : 0;
+    //clockwise from straight up, the even ones are the neighbours
+    int ring[8] = {up*g->width + x, up*g->width + right, y*g->width + right, down*g->width + right,
+                   down*g->width + x, down*g->width + left, y*g->width + left, up*g->width + left};
+    bool empty[8];
+    for (int i=0; i<8; i++) empty[i] = g->deg[ring[i]] > 0 && !s->visited[ring[i]];
+    //count the runs of free squares round the ring that have a neighbour in them
+    int runs = 0, begin = 0;
+    while (begin < 8 && empty[begin]) begin++;
+    if (begin == 8) return false;
+    bool neighbour = false;
+    for (int i=1; i<=8; i++) {
+        int r = (begin + i) % 8;
+        if (empty[r]) {
+            if (r % 2 == 0) neighbour = true;
+        } else {
+            if (neighbour) runs++;
+            neighbour = false;
+        }
+    }
+    return runs > 1;
+}
+
+//floods the unvisited squares from next to c, true if it reached all of them
+static bool joined(search *s, int c) {
+    graph *g = s->g;
+    int from = -1;
+    for (int k=0; k<g->deg[c] && from == -1; k++) if (!s->visited[g->adj[c*4 + k]]) from = g->adj[c*4 + k];
+    if (from == -1) return false;
+    s->flood++;
+    int head = 0, tail = 0;
+    s->queue[tail++] = from;
+    s->mark[from] = s->flood;
+    while (head < tail) {
+        int v = s->queue[head++];
+        for (int k=0; k<g->deg[v]; k++) {
+            int u = g->adj[v*4 + k];
+            if (s->visited[u] || s->mark[u] == s->flood) continue;
+            s->mark[u] = s->flood;
+            s->queue[tail++] = u;
+        }
+    }
+    return tail == s->left;
+}
+
+//moves the head of the path on to c
+static void take(search *s, int c) {
+    graph *g = s->g;
+    int head = s->path[s->depth];
+    if (head != s->start)
+        for (int k=0; k<g->deg[head]; k++) s->ways[g->adj[head*4 + k]]--;
+    s->visited[c] = true;
+    s->left--;
+    s->colours[colour(g, c)]--;
+    if (nextto(g, s->start, c)) s->startWays--;
+    s->path[++s->depth] = c;
+}
+
+//takes the head of the path back off
+static void untake(search *s) {
+    graph *g = s->g;
+    int c = s->path[s->depth--], head = s->path[s->depth];
+    s->visited[c] = false;
+    s->left++;
+    s->colours[colour(g, c)]++;
+    if (nextto(g, s->start, c)) s->startWays++;
+    if (head != s->start)
+        for (int k=0; k<g->deg[head]; k++) s->ways[g->adj[head*4 + k]]++;
+}
+
+//whether the path can still be made into a loop after the last square was taken
+static bool possible(search *s) {
+    graph *g = s->g;
+    int c = s->path[s->depth], last = s->path[s->depth-1];
+    if (s->left == 0) return nextto(g, c, s->start);
+    if (s->startWays == 0) return false;
+    //every square the last one was next to needs two ways left, one in and one out
+    if (last != s->start)
+        for (int k=0; k<g->deg[last]; k++) {
+            int u = g->adj[last*4 + k];
+            if (!s->visited[u] && s->ways[u] < 2) return false;
+        }
+    //the rest of the path alternates colours from the head, and has to end next to the start
+    if (g->bipartite) {
+        int mine = colour(g, c);
+        if (s->colours[!mine] != (s->left + 1) / 2 || s->colours[mine] != s->left / 2) return false;
+    }
+    return !mightsplit(s, c) || joined(s, c);
+}
+
+//works out which neighbours of the head to try next, the ones with the fewest ways out first.
+//A neighbour with only the head and one other way left has to be next, or it'd be cut off
+//(unless the head is the start, which it can always come back to)
+static void choose(search *s) {
+    graph *g = s->g;
+    int c = s->path[s->depth], n = 0, forced = -1;
+    int *choices = &s->choices[s->depth * 4], shuffled[4];
+    for (int k=0; k<g->deg[c]; k++) {
+        int j = rngrange(&s->random, k + 1);
+        shuffled[k] = shuffled[j];
+        shuffled[j] = g->adj[c*4 + k];
+    }
+    for (int k=0; k<g->deg[c]; k++) {
+        int u = shuffled[k];
+        if (s->visited[u]) continue;
+        if (s->ways[u] == 2 && s->left > 1 && c != s->start) {
+            if (forced != -1) {
+                //two of them can't both be next
+                n = 0;
+                break;
+            }
+            forced = u;
+        }
+        int i = n++;
+        while (i > 0 && s->ways[choices[i-1]] > s->ways[u]) {
+            choices[i] = choices[i-1];
+            i--;
+        }
+        choices[i] = u;
+    }
+    if (forced != -1 && n > 0) {
+        choices[0] = forced;
+        n = 1;
+    }
+    s->numChoices[s->depth] = n;
+    s->tried[s->depth] = 0;
+}
+
+//looks for a loop through every open square of e's map, giving up after budget steps.
+//Returns what it found out, which is kept in h along with the loop if there is one
+int hfind(hamcycle *h, engine *e, long budget) {
+    TRACE("hfind");
+    graph g = {0, 0, 0, 0, NULL, NULL, false};
+    search s;
+    bool ok = hsize(h, e->width, e->height) && makegraph(&g, e);
+    h->hash = maphash(e);
+    h->reason[0] = '\0';
+    memset(&s, 0, sizeof(s));
+    if (ok) {
+        s.path = (int*)malloc(sizeof(int) * (g.open + 1));
+        s.visited = (bool*)calloc(g.squares, sizeof(bool));
+        s.ways = (int*)malloc(sizeof(int) * g.squares);
+        s.choices = (int*)malloc(sizeof(int) * 4 * (g.open + 1));
+        s.numChoices = (int*)malloc(sizeof(int) * (g.open + 1));
+        s.tried = (int*)malloc(sizeof(int) * (g.open + 1));
+        s.queue = (int*)malloc(sizeof(int) * g.squares);
+        s.mark = (int*)calloc(g.squares, sizeof(int));
+        ok = s.path && s.visited && s.ways && s.choices && s.numChoices && s.tried && s.queue && s.mark;
+    }
+    if (!ok) {
+        h->status = CycleGaveUp;
+        snprintf(h->reason, sizeof(h->reason), "not enough memory to look for a loop");
+    } else if (ruledout(&g, e, h->reason, sizeof(h->reason))) {
+        h->status = CycleImpossible;
+    } else if (blocks(h, &g, e)) {
+        h->status = CycleFound;
+    } else {
+        //start on the most awkward square, it's the one most likely to go wrong later
+        s.g = &g;
+        s.start = -1;
+        for (int c=0; c<g.squares; c++) {
+            if (g.deg[c] > 0 && (s.start == -1 || g.deg[c] < g.deg[s.start])) s.start = c;
+        }
+        s.left = g.open - 1;
+        for (int c=0; c<g.squares; c++) {
+            s.ways[c] = g.deg[c];
+            if (g.deg[c] > 0 && c != s.start) s.colours[colour(&g, c)]++;
+        }
+        s.startWays = g.deg[s.start];
+        s.visited[s.start] = true;
+        s.path[0] = s.start;
+        s.depth = 0;
+        rngseed(&s.random, h->hash);
+        choose(&s);
+
+        //a search that goes wrong early can spend forever undoing the end of the path, so it
+        //starts over every so often with the ties broken differently, and a bit longer each time
+        long steps = 0, sinceStart = 0, restart = firstRestart;
+        h->status = CycleGaveUp;
+        while (true) {
+            if (++steps > budget || (steps % 4096 == 0 && stopping)) {
+                snprintf(h->reason, sizeof(h->reason), "no loop was found in %ld steps", budget);
+                break;
+            }
+            if (++sinceStart > restart) {
+                while (s.depth > 0) untake(&s);
+                choose(&s);
+                sinceStart = 0;
+                restart += restart / 2;
+            }
+            if (s.tried[s.depth] == s.numChoices[s.depth]) {
+                //every way on from here has been tried
+                if (s.depth == 0) {
+                    h->status = CycleImpossible;
+                    snprintf(h->reason, sizeof(h->reason), "every way round the map was tried");
+                    break;
+                }
+                untake(&s);
+                continue;
+            }
+            take(&s, s.choices[s.depth*4 + s.tried[s.depth]++]);
+            if (!possible(&s)) {
+                untake(&s);
+                continue;
+            }
+            if (s.left == 0) {
+                h->status = CycleFound;
+                break;
+            }
+            choose(&s);
+        }
+
+        if (h->status == CycleFound) {
+            h->length = g.open;
+            for (int i=0; i<g.open; i++) {
+                h->squares[i] = s.path[i];
+                h->order[s.path[i]] = i;
+            }
+        }
+    }
+
+    free(s.path), free(s.visited), free(s.ways), free(s.choices);
+    free(s.numChoices), free(s.tried), free(s.queue), free(s.mark);
+    freegraph(&g);
+    return h->status;
+}
+
+static void write32(FILE *f, uint32_t n) {
+    unsigned char b[4] = {(unsigned char)n, (unsigned char)(n >> 8), (unsigned char)(n >> 16), (unsigned char)(n >> 24)};
+    fwrite(b, 1, 4, f);
+}
+
+static bool read32(FILE *f, uint32_t *n) {
+    unsigned char b[4];
+    if (fread(b, 1, 4, f) != 4) return false;
+    *n = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+    return true;
+}
+
+//the direction (minus one) from square a to square b, or -1 if they aren't next to each other
+static int towards(hamcycle *h, int a, int b) {
+    int next[4];
+    around(h->width, h->height, a, next);
+    for (int d=0; d<4; d++) if (next[d] == b) return d;
+    return -1;
+}
+
+bool hsave(hamcycle *h, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) return false;
+    int reason = strlen(h->reason);
+    fwrite("SCYC", 1, 4, f);
+    write32(f, 1);
+    write32(f, (uint32_t)h->hash);
+    write32(f, (uint32_t)(h->hash >> 32));
+    write32(f, h->width);
+    write32(f, h->height);
+    write32(f, h->status);
+    fputc(reason, f);
+    fwrite(h->reason, 1, reason, f);
+    write32(f, h->length);
+    if (h->length > 0) {
+        write32(f, h->squares[0] % h->width);
+        write32(f, h->squares[0] / h->width);
+    }
+    int packed = 0;
+    for (int i=1; i<h->length; i++) {
+        packed |= towards(h, h->squares[i-1], h->squares[i]) << ((i-1) % 4 * 2);
+        if ((i-1) % 4 == 3 || i == h->length - 1) {
+            fputc(packed, f);
+            packed = 0;
+        }
+    }
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+//loads a cycle file, which has to be for e's map and go through every open square of it
+//exactly once. h is only usable if this returns true
+bool hload(hamcycle *h, const char *path, engine *e) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+    char magic[4];
+    uint32_t version, low, high, width, height, status, length, x = 0, y = 0;
+    bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, "SCYC", 4) == 0 && read32(f, &version) && version == 1
+           && read32(f, &low) && read32(f, &high) && (((uint64_t)high << 32) | low) == maphash(e)
+           && read32(f, &width) && read32(f, &height) && read32(f, &status)
+           && (int)width == e->width && (int)height == e->height && status <= CycleGaveUp
+           && hsize(h, width, height);
+    int reason = ok ? fgetc(f) : EOF;
+    ok = ok && reason != EOF && reason < (int)sizeof(h->reason) && (int)fread(h->reason, 1, reason, f) == reason
+         && read32(f, &length) && length <= width * height;
+    if (ok) {
+        h->reason[reason] = '\0';
+        h->status = status;
+        h->hash = maphash(e);
+    }
+    if (ok && length > 0) ok = read32(f, &x) && read32(f, &y) && x < width && y < height;
+
+    //follow the loop round, every square has to be open and new, and the last has to be next to the first
+    int open = 0;
+    for (int c=0; ok && c<e->width * e->height; c++) open += isopen(e, c);
+    ok = ok && (status == CycleFound ? (int)length == open : length == 0);
+    int c = y * width + x, packed = 0;
+    for (int i=0; ok && i<(int)length; i++) {
+        if (i > 0) {
+            if ((i-1) % 4 == 0) packed = fgetc(f);
+            int next[4];
+            around(width, height, c, next);
+            c = next[(packed >> ((i-1) % 4 * 2)) & 3];
+            ok = packed != EOF;
+        }
+        ok = ok && isopen(e, c) && h->order[c] == -1;
+        if (!ok) break;
+        h->squares[i] = c;
+        h->order[c] = i;
+    }
+    ok = ok && (length == 0 || towards(h, h->squares[length-1], h->squares[0]) != -1) && fgetc(f) == EOF;
+    fclose(f);
+    if (ok) h->length = length;
+    return ok;
+}
+
+//how far round the loop square b is from square a
+static int ahead(hamcycle *h, int a, int b) {
+    return (h->order[b] - h->order[a] + h->length) % h->length;
+}
+
+//which way the demo snake should go. It goes round the loop, cutting across it towards the food
+//when that leaves plenty of room between its head and its tail
+int hsteer(hamcycle *h, engine *e) {
+    if (h->status != CycleFound || h->width != e->width || h->height != e->height) return None;
+    int n = h->length, head = e->posy * e->width + e->posx;
+    if (h->order[head] == -1) return None;
+    segment *tail = getElem(&e->body, 0);
+    int room = e->body.length > 1 ? ahead(h, head, tail->y * e->width + tail->x) : n;
+    int food = e->foodx != -1 ? ahead(h, head, e->foody * e->width + e->foodx) : n;
+
+    //the next square round the loop is always safe, shortcuts are only taken while the snake is short
+    int next[4], best = -1, bestAhead = 0;
+    around(e->width, e->height, head, next);
+    for (int d=0; d<4; d++) {
+        int c = next[d];
+        if (h->order[c] == -1 || getgrid(e, c % e->width, c / e->width) == Snake) continue;
+        int along = ahead(h, head, c);
+        bool shortcut = e->body.length + e->extend < n / 2 && along <= food && along < room - e->extend - 3;
+        if ((along == 1 || shortcut) && along > bestAhead) {
+            best = d;
+            bestAhead = along;
+        }
+    }
+    return best == -1 ? None : best + 1;
+}
+
+//the background search and the map it's searching, which is a copy so the game can carry on
+static std::thread worker;
+static std::atomic<bool> finished(false);
+static engine board;
+static bool haveBoard = false;
+static hamcycle found;
+static char cacheFile[4096];
+static bool caching;
+
+//how it went is left in found's status and reason for the demo to show, nothing is printed
+//since the search runs every time a map is loaded
+static void searchmap() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (caching && hload(&found, cacheFile, &board)) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (found.status == CycleFound) snprintf(found.reason, sizeof(found.reason), "loaded in %.1f ms", elapsed.count());
+        finished = true;
+        return;
+    }
+    hfind(&found, &board, cycleBudget);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    //a search that was stopped part way didn't find out anything worth keeping
+    if (caching && !stopping && !hsave(&found, cacheFile)) fprintf(stderr, "could not save %s\n", cacheFile);
+    //the time isn't saved with the loop, it's only for this search
+    if (found.status == CycleFound) snprintf(found.reason, sizeof(found.reason), "found in %.1f ms", elapsed.count());
+    finished = true;
+}
+
+void hstart(engine *e, const char *mapFile) {
+    hstop();
+    if (!haveBoard) {
+        hinit(&found);
+        haveBoard = einit(&board);
+    }
+    caching = mapFile != NULL;
+    if (caching) snprintf(cacheFile, sizeof(cacheFile), "%s.cyc", mapFile);
+    if (!haveBoard || !ecopy(&board, e)) {
+        found.status = CycleGaveUp;
+        snprintf(found.reason, sizeof(found.reason), "not enough memory to look for a loop");
+        finished = true;
+        return;
+    }
+    worker = std::thread(searchmap);
+}
+
+hamcycle *hready() {
+    return finished ? &found : NULL;
+}
+
+//stops the search if it's still going, and frees everything it was using
+void hstop() {
+    stopping = true;
+    if (worker.joinable()) worker.join();
+    stopping = false;
+    finished = false;
+    if (haveBoard) {
+        edestroy(&board);
+        hdestroy(&found);
+        haveBoard = false;
+    }
+}
@@ -0,0 +1,56 @@
+/* Eddy Gao                     Serpens - Cycles                             ICS3U
+The demo snake that always fills the board. It follows a Hamiltonian cycle, a loop
+that goes through every open square of the map exactly once (wrapping around the
+edges like the snake does), so it can never run into itself. While it's short it
+cuts across the loop towards the food, but only to squares further along the loop
+than its head and well short of its tail, which keeps its body in loop order.
+Finding the loop can take a long time on maps full of walls, so it's done once per
+map on a thread of its own after the map is loaded, and kept in a file next to the
+map (the map's name with .cyc on the end) along with a hash of the map, so the next
+time the map is played the loop is just read back in. A map that can't have a loop
+gets a file too, saying why.
+*/
+#ifndef CYCLE_H
+#define CYCLE_H
+
+#include <stdint.h>
+#include "engine.h"
+
+//how many steps the search takes before giving up on a map, several seconds of searching
+const long cycleBudget = 20000000;
+
+//what hfind found out about a map
+enum CycleStatus {
+    CycleFound = 0,
+    CycleImpossible,    //there can't be a loop, reason says why
+    CycleGaveUp         //there might be one, but the search ran out of steps
+};
+
+typedef struct hamcycle {
+    int width, height;
+    //squares (y*width + x) in the order the loop goes through them, and each square's
+    //place in that order, or -1 if it's a wall. length is how many squares are in the loop
+    int *squares, *order, length;
+    //the map the loop was found for, see maphash()
+    uint64_t hash;
+    int status;
+    //why there's no loop, or for one found by hstart, how long it took to find or load
+    char reason[128];
+} hamcycle;
+
+void hinit(hamcycle *h);
+void hdestroy(hamcycle *h);
+uint64_t maphash(engine *e);
+int hfind(hamcycle *h, engine *e, long budget);
+bool hsave(hamcycle *h, const char *path);
+bool hload(hamcycle *h, const char *path, engine *e);
+int hsteer(hamcycle *h, engine *e);
+
+//the search on its own thread: hstart looks for the loop through e's map, reading it from
+//mapFile's cache if it can (mapFile can be NULL for a map that isn't in a file). hready is
+//NULL until it's done, hstop gives up on it
+void hstart(engine *e, const char *mapFile);
+hamcycle *hready();
+void hstop();
+
+#endif
@@ -0,0 +1,364 @@
+/* Eddy Gao                     Serpens - Engine                             ICS3U
+Game rules for Serpens. See engine.h.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "mapfile.h"
+#include "trace.h"
+
+//sets up an empty map of the default size
+bool einit(engine *e) {
+    e->width = e->height = e->stride = 0;
+    e->sized = NULL;
+    e->grid = e->map = NULL;
+    e->freeCells = e->freeIndex = NULL;
+    e->body.cells = NULL;
+    e->spawnx = 0;
+    e->spawny = 0;
+    e->bonusCounter = 300;
+    if (!setsize(e, defaultWidth, defaultHeight)) return false;
+    newgame(e, 0);
+    return true;
+}
+
+void edestroy(engine *e) {
+    free(e->grid);
+    free(e->map);
+    free(e->freeCells);
+    free(e->freeIndex);
+    sdestroy(&e->body);
+    e->grid = e->map = NULL;
+    e->freeCells = e->freeIndex = NULL;
+}
+
+//makes room for a map of the given size, and empties it
+bool setsize(engine *e, int width, int height) {
+    int stride = (width + 15) / 16;
+    if (width != e->width || height != e->height) {
+        edestroy(e);
+        e->grid = (uint64_t*)malloc(sizeof(uint64_t) * stride * height);
+        e->map = (uint64_t*)malloc(sizeof(uint64_t) * stride * height);
+        e->freeCells = (int*)malloc(sizeof(int) * width * height);
+        e->freeIndex = (int*)malloc(sizeof(int) * width * height);
+        //the snake can never be longer than the grid, so this is the only allocation it needs
+        sinit(&e->body, width * height);
+        if (!e->grid || !e->map || !e->freeCells || !e->freeIndex || !e->body.cells) {
+            edestroy(e);
+            e->width = e->height = e->stride = 0;
+            pickstep(e, false);
+            return false;
+        }
+        e->width = width;
+        e->height = height;
+        e->stride = stride;
+    }
+    pickstep(e, true);
+    memset(e->grid, 0, sizeof(uint64_t) * stride * height);
+    memset(e->map, 0, sizeof(uint64_t) * stride * height);
+    sclear(&e->body);
+    e->numFree = 0;
+    return true;
+}
+
+//handles map loading, in either of the formats in mapfile.h
+bool loadMap(engine *e, const char *input) {
+    TRACE("loadMap");
+    //what each MapTile is in the grid, the spawn point is just empty
+    static const GridSquare squares[4] = {Empty, Snake, Empty, Infertile};
+    mapdata m;
+
+    if (!readmap(&m, input)) return false;
+    if (!setsize(e, m.width, m.height)) {
+        freemap(&m);
+        return false;
+    }
+
+    //pack the map 16 squares at a time, note that the walls are to be represented as immobile snakes
+    for (int y=0; y<m.height; y++) {
+        const unsigned char *row = m.tiles + (long)y*m.width;
+        for (int w=0; w<e->stride; w++) {
+            int n = m.width - w*16;
+            if (n > 16) n = 16;
+            uint64_t word = 0;
+            for (int i=0; i<n; i++) word |= (uint64_t)squares[row[w*16 + i] & 3] << (i*4);
+            e->map[y*e->stride + w] = word;
+        }
+    }
+    e->spawnx = m.spawnx != -1 ? m.spawnx : 0;
+    e->spawny = m.spawny != -1 ? m.spawny : 0;
+
+    freemap(&m);
+    newgame(e, e->seed);
+    return true;
+}
+
+//makes to an exact copy of from, including the generator, so both play out the same way from here.
+//Memory is only allocated if the map sizes differ, so bots can branch off a position cheaply
+bool ecopy(engine *to, engine *from) {
+    if ((to->width != from->width || to->height != from->height) && !setsize(to, from->width, from->height)) return false;
+    long words = (long)from->stride * from->height, squares = (long)from->width * from->height;
+    memcpy(to->map, from->map, sizeof(uint64_t) * words);
+    memcpy(to->grid, from->grid, sizeof(uint64_t) * words);
+    memcpy(to->freeCells, from->freeCells, sizeof(int) * from->numFree);
+    memcpy(to->freeIndex, from->freeIndex, sizeof(int) * squares);
+
+    //the body is copied tail first to the start of the buffer, which might be split in two in from
+    snake body = to->body;
+    int first = from->body.capacity - from->body.start;
+    if (first > from->body.length) first = from->body.length;
+    memcpy(body.cells, from->body.cells + from->body.start, sizeof(segment) * first);
+    memcpy(body.cells + first, from->body.cells, sizeof(segment) * (from->body.length - first));
+    body.start = 0;
+    body.length = from->body.length;
+
+    //everything else is a plain value, so copy the lot and put back the arrays to's got
+    uint64_t *grid = to->grid, *map = to->map;
+    int *freeCells = to->freeCells, *freeIndex = to->freeIndex;
+    *to = *from;
+    to->grid = grid;
+    to->map = map;
+    to->freeCells = freeCells;
+    to->freeIndex = freeIndex;
+    to->body = body;
+    return true;
+}
+
+//resets the game to its initial state on the current map, everything random about it comes from seed
+void newgame(engine *e, uint64_t seed) {
+    e->seed = seed;
+    rngseed(&e->random, seed);
+    e->tick = 0;
+    memcpy(e->grid, e->map, sizeof(uint64_t) * e->stride * e->height);
+    indexgrid(e);
+    setgrid(e, e->spawnx, e->spawny, Snake);
+    e->velx = 0;
+    e->vely = 0;
+    e->extend = 10;
+    e->score = 0;
+    e->bonusCounter = 300;
+    e->posx = e->spawnx;
+    e->posy = e->spawny;
+    e->specx = -1;
+    e->specy = -1;
+    e->speed = 10;
+    sclear(&e->body);
+    sappend(&e->body, e->posx, e->posy);
+    if (!placefood(e)) {
+        //the map has nowhere for food to go
+        e->foodx = -1;
+        e->foody = -1;
+    }
+    //never start with a special food
+    if (e->specx!=-1) {
+        setgrid(e, e->specx, e->specy, getmap(e, e->specx, e->specy));
+        e->specx=-1;
+        e->specy=-1;
+    }
+}
+
+//whether the snake is allowed to turn this way, it can't reverse into itself
+bool canturn(engine *e, int direction) {
+    switch (direction) {
+    case Up:
+    case Down:
+        return e->vely == 0;
+    case Left:
+    case Right:
+        return e->velx == 0;
+    }
+    return false;
+}
+
+//The code that runs every tick is compiled once for each of the stock map sizes in stockSizes,
+//with the size as a constant the compiler can fold into the arithmetic: going round the edges,
+//finding a square's word in the grid and turning a free square's number back into x and y,
+//which become masks and shifts when the size is a power of two. Any other size gets the copy
+//with W and H 0, which reads the size out of the engine.
+template <int W, int H> struct gridsize {
+    const engine *e;
+
+    int width() const { return W > 0 ? W : e->width; }
+    int height() const { return H > 0 ? H : e->height; }
+    int stride() const { return W > 0 ? (W + 15) / 16 : e->stride; }
+
+    //a coordinate that's gone at most one square past an edge, brought back round
+    int wrapx(int x) const {
+        if (W > 0 && (W & (W - 1)) == 0) return x & (W - 1);
+        return x < 0 ? x + width() : x >= width() ? x - width() : x;
+    }
+    int wrapy(int y) const {
+        if (H > 0 && (H & (H - 1)) == 0) return y & (H - 1);
+        return y < 0 ? y + height() : y >= height() ? y - height() : y;
+    }
+
+    //squares numbered one row after another, like freeCells
+    int index(int x, int y) const { return y * width() + x; }
+    int column(int c) const { return (unsigned)c % (unsigned)width(); }
+    int row(int c) const { return (unsigned)c / (unsigned)width(); }
+};
+
+//changes a grid square, keeping the list of free squares up to date
+template <int W, int H> static void setgridsized(engine *e, int x, int y, GridSquare type) {
+    gridsize<W, H> g = {e};
+    int c = g.index(x, y);
+    GridSquare old = getsquare(e->grid, g.stride(), x, y);
+    if (old == Empty && type != Empty) {
+        //fill the hole with the last free square in the list
+        int last = e->freeCells[--e->numFree];
+        e->freeCells[e->freeIndex[c]] = last;
+        e->freeIndex[last] = e->freeIndex[c];
+        e->freeIndex[c] = -1;
+    } else if (old != Empty && type == Empty) {
+        e->freeIndex[c] = e->numFree;
+        e->freeCells[e->numFree++] = c;
+    }
+    setsquare(e->grid, g.stride(), x, y, type);
+}
+
+//This function replaces the food, and has a chance of spawning a special food
+//returns false if there is no free square left to put the food on
+template <int W, int H> static bool placefoodsized(engine *e) {
+    TRACE("placefood");
+    gridsize<W, H> g = {e};
+    if (e->numFree == 0) return false;
+    int c = e->freeCells[rngrange(&e->random, e->numFree)];
+    e->foodx = g.column(c);
+    e->foody = g.row(c);
+    setgridsized<W, H>(e, e->foodx, e->foody, Food);
+
+    //20% chance of special food, and only if it isn't already there
+    if (rngrange(&e->random, 10)<2 && e->specx == -1 && e->numFree > 0) {
+        c = e->freeCells[rngrange(&e->random, e->numFree)];
+        e->specx = g.column(c);
+        e->specy = g.row(c);
+        setgridsized<W, H>(e, e->specx, e->specy, Special);
+    }
+    return true;
+}
+
+//advances the game by one tick, turning first if a direction is given
+template <int W, int H> static int stepsized(engine *e, int direction) {
+    TRACE("step");
+    gridsize<W, H> g = {e};
+    int events = 0;
+    e->tick++;
+
+    //decrease bonusCounter that is used for special foods
+    if (e->bonusCounter>50) e->bonusCounter--;
+
+    if (canturn(e, direction)) {
+        e->velx = (direction == Right) - (direction == Left);
+        e->vely = (direction == Down) - (direction == Up);
+    }
+
+    if (e->velx == 0 && e->vely == 0) return events;
+
+    //if (snake isn't supposed to be growing in length this tick)
+    if (e->extend == 0) {
+        e->leftover = spop(&e->body);
+        //remove from grid
+        setgridsized<W, H>(e, e->leftover.x, e->leftover.y, getsquare(e->map, g.stride(), e->leftover.x, e->leftover.y));
+        events |= TailMoved;
+    } else {
+        //decrease the length the snake should extend as the snake has just lengthened
+        --e->extend;
+    }
+
+    //move snake, wrapping around the screen if necessary
+    e->posx = g.wrapx(e->posx + e->velx);
+    e->posy = g.wrapy(e->posy + e->vely);
+
+    //if snake gets food
+    GridSquare target = getsquare(e->grid, g.stride(), e->posx, e->posy);
+    if (target == Food) {
+        events |= Ate;
+        e->score += 10;
+        e->extend++;
+        if (e->speed>10) e->speed--;
+        //replace food, if there's nowhere left to put it then the board is full
+        if (!placefoodsized<W, H>(e)) events |= Won;
+    } else if (target == Special) {
+        events |= AteSpecial;
+        e->specx=-1;
+        e->specy=-1;
+        e->score+=e->bonusCounter/10;
+        e->bonusCounter=300;
+        e->extend++;
+        if (e->speed>10) e->speed--;
+    } else if (target == Snake) {
+        //lose the game
+        return events | Died;
+    }
+    //add to the beginning of the snake. It's traced here rather than in snake.h, where it would
+    //be different in files built with and without tracing
+    {
+        TRACE("sappend");
+        sappend(&e->body, e->posx, e->posy);
+    }
+    setgridsized<W, H>(e, e->posx, e->posy, Snake);
+    return events | Moved;
+}
+
+//rebuilds the list of free squares from scratch, a word of the grid at a time
+template <int W, int H> static void indexgridsized(engine *e) {
+    gridsize<W, H> g = {e};
+    e->numFree = 0;
+    for (int y=0; y<g.height(); y++) {
+        const uint64_t *row = &e->grid[y * g.stride()];
+        for (int w=0; w<g.stride(); w++) {
+            uint64_t word = row[w];
+            int n = g.width() - w*16 < 16 ? g.width() - w*16 : 16;
+            for (int i=0; i<n; i++, word >>= 4) {
+                int c = g.index(w*16 + i, y);
+                if ((word & 15) == Empty) {
+                    e->freeIndex[c] = e->numFree;
+                    e->freeCells[e->numFree++] = c;
+                } else e->freeIndex[c] = -1;
+            }
+        }
+    }
+}
+
+//the code compiled for one size. The stock sizes are the default map and squares that are powers of two
+typedef struct gridcode {
+    int width, height;
+    int (*step)(engine *e, int direction);
+    void (*index)(engine *e);
+    bool (*placefood)(engine *e);
+    void (*setgrid)(engine *e, int x, int y, GridSquare type);
+} gridcode;
+
+static const gridcode anySize = {0, 0, stepsized<0, 0>, indexgridsized<0, 0>, placefoodsized<0, 0>, setgridsized<0, 0>};
+static const gridcode stockSizes[] = {
+    {defaultWidth, defaultHeight, stepsized<defaultWidth, defaultHeight>, indexgridsized<defaultWidth, defaultHeight>, placefoodsized<defaultWidth, defaultHeight>, setgridsized<defaultWidth, defaultHeight>},
+    {32, 32, stepsized<32, 32>, indexgridsized<32, 32>, placefoodsized<32, 32>, setgridsized<32, 32>},
+    {64, 64, stepsized<64, 64>, indexgridsized<64, 64>, placefoodsized<64, 64>, setgridsized<64, 64>},
+    {128, 128, stepsized<128, 128>, indexgridsized<128, 128>, placefoodsized<128, 128>, setgridsized<128, 128>},
+    {256, 256, stepsized<256, 256>, indexgridsized<256, 256>, placefoodsized<256, 256>, setgridsized<256, 256>}
+};
+
+void pickstep(engine *e, bool fixedSize) {
+    e->sized = &anySize;
+    if (!fixedSize) return;
+    for (size_t i=0; i<sizeof(stockSizes) / sizeof(stockSizes[0]); i++) {
+        if (stockSizes[i].width == e->width && stockSizes[i].height == e->height) e->sized = &stockSizes[i];
+    }
+}
+
+int step(engine *e, int direction) {
+    return e->sized->step(e, direction);
+}
+
+bool placefood(engine *e) {
+    return e->sized->placefood(e);
+}
+
+void setgrid(engine *e, int x, int y, GridSquare type) {
+    e->sized->setgrid(e, x, y, type);
+}
+
+void indexgrid(engine *e) {
+    e->sized->index(e);
+}
@@ -0,0 +1,115 @@
+/* Eddy Gao                     Serpens - Engine                             ICS3U
+The rules of the game, kept apart from allegro so they can be run without a
+window and as fast as the computer allows. Everything about one game lives in an
+engine structure, and the game is advanced one tick at a time with step().
+All of the randomness comes from the engine's own generator, so a game started
+with the same seed on the same map plays out the same way given the same turns.
+*/
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdint.h>
+#include "snake.h"
+#include "rng.h"
+
+//size of the map when none has been loaded
+const int defaultWidth = 24, defaultHeight = 30;
+
+//types of grid squares, these have to fit in 4 bits
+enum GridSquare {
+    Empty = 0,
+    Snake,
+    Food,
+    Infertile,
+    Special,
+    //in arena games (see arena.h) snake n's squares are Owned + n, walls are still Snake
+    Owned = 8
+};
+
+//directions the snake can be steered in
+enum Direction {
+    None = 0,
+    Up,
+    Down,
+    Left,
+    Right
+};
+
+//things that can happen in one tick, step() returns a combination of these
+enum Event {
+    Moved = 1,      //the head moved to (posx, posy)
+    TailMoved = 2,  //the tail moved on, leaving the square in leftover
+    Ate = 4,        //food was eaten and placed somewhere else
+    AteSpecial = 8, //a special food was eaten
+    Died = 16,      //the snake ran into something
+    Won = 32        //the board is full, there is nowhere to put the next food
+};
+
+typedef struct engine {
+    //size of the map in squares, and the number of 64 bit words in a row of the grid
+    int width, height, stride;
+
+    //grid stores current state, map stores the initial state. Both are packed
+    //16 squares to a word, 4 bits a square, one row after another
+    uint64_t *grid, *map;
+
+    //every Empty square (the ones food can spawn on) is listed in freeCells, and
+    //freeIndex maps a square back to its spot in that list, or -1 if it isn't free
+    int *freeCells, *freeIndex, numFree;
+
+    snake body;
+    segment leftover;
+    int spawnx, spawny;
+    int posx, posy, velx, vely;
+    int foodx, foody, specx, specy;
+    int extend, score, bonusCounter;
+    float speed;
+
+    //the seed the current game was started with, and the generator it seeded
+    uint64_t seed;
+    rng random;
+    //number of ticks since the game started
+    int tick;
+
+    //what step(), placefood(), setgrid() and indexgrid() run, compiled for this map's size
+    //if it's a stock size (see pickstep)
+    const struct gridcode *sized;
+} engine;
+
+bool einit(engine *e);
+void edestroy(engine *e);
+bool setsize(engine *e, int width, int height);
+bool loadMap(engine *e, const char *input);
+bool ecopy(engine *to, engine *from);
+void newgame(engine *e, uint64_t seed);
+bool canturn(engine *e, int direction);
+int step(engine *e, int direction);
+bool placefood(engine *e);
+void setgrid(engine *e, int x, int y, GridSquare type);
+void indexgrid(engine *e);
+//chooses the code step(), placefood(), setgrid() and indexgrid() run: compiled for exactly this
+//map's size if it's one of the stock sizes and fixedSize is set, or the code for any size.
+//setsize() calls it with true
+void pickstep(engine *e, bool fixedSize);
+
+//reads one square out of a packed grid
+inline GridSquare getsquare(const uint64_t *cells, int stride, int x, int y) {
+    return (GridSquare)((cells[y*stride + (x >> 4)] >> ((x & 15) << 2)) & 15);
+}
+
+//writes one square into a packed grid
+inline void setsquare(uint64_t *cells, int stride, int x, int y, GridSquare type) {
+    uint64_t *word = &cells[y*stride + (x >> 4)];
+    int shift = (x & 15) << 2;
+    *word = (*word & ~((uint64_t)15 << shift)) | ((uint64_t)type << shift);
+}
+
+inline GridSquare getgrid(engine *e, int x, int y) {
+    return getsquare(e->grid, e->stride, x, y);
+}
+
+inline GridSquare getmap(engine *e, int x, int y) {
+    return getsquare(e->map, e->stride, x, y);
+}
+
+#endif
@@ -0,0 +1,162 @@
+/* Eddy Gao                     Serpens - Waiting for input                  ICS3U
+The input waiting layer. See events.h.
+*/
+#include <allegro.h>
+#ifdef _WIN32
+#include <winalleg.h>
+#else
+#include <sys/resource.h>
+#endif
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "events.h"
+
+//longest waitkey() sleeps before checking again, in case a key got in without a callback
+const int keyTimeout = 100;
+
+//how many key presses to remember the times of, more than allegro's key buffer holds
+const int keyHistory = 128;
+
+//pending is set whenever input arrives, and cleared by whoever waits for it
+static std::mutex lock;
+static std::condition_variable wake;
+static bool pending = false;
+
+//the keys that went into allegro's key buffer and when, oldest first, also guarded by lock
+static int keyCodes[keyHistory];
+static std::chrono::steady_clock::time_point keyTimes[keyHistory];
+static int keyStart = 0, keyCount = 0;
+
+//the callbacks that were there before, put back by removeevents()
+static int (*oldKeyboard)(int) = NULL;
+static void (*oldMouse)(int) = NULL;
+
+//for measuring how much of the time the program spends running rather than waiting
+static std::chrono::steady_clock::time_point started;
+static double startCPU;
+
+//these are called by allegro from its own thread whenever there's input
+static int keyEvent(int key) {
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        if (keyCount == keyHistory) {
+            keyStart = (keyStart + 1) % keyHistory;
+            keyCount--;
+        }
+        int i = (keyStart + keyCount++) % keyHistory;
+        keyCodes[i] = key;
+        keyTimes[i] = std::chrono::steady_clock::now();
+    }
+    wakeevents();
+    return oldKeyboard ? oldKeyboard(key) : key;
+}
+END_OF_FUNCTION(keyEvent)
+
+static void mouseEvent(int flags) {
+    wakeevents();
+    if (oldMouse) oldMouse(flags);
+}
+END_OF_FUNCTION(mouseEvent)
+
+//the processor time this program has used so far, in seconds
+static double cputime() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 1e7;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+//hooks into allegro's keyboard and mouse callbacks, this has to come after install_keyboard and install_mouse
+void installevents() {
+    LOCK_FUNCTION(keyEvent);
+    LOCK_FUNCTION(mouseEvent);
+    oldKeyboard = keyboard_callback;
+    oldMouse = mouse_callback;
+    keyboard_callback = keyEvent;
+    mouse_callback = mouseEvent;
+    started = std::chrono::steady_clock::now();
+    startCPU = cputime();
+}
+
+void removeevents() {
+    keyboard_callback = oldKeyboard;
+    mouse_callback = oldMouse;
+}
+
+//wakes up anything waiting, for things that happen without input, like the close button
+void wakeevents() {
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        pending = true;
+    }
+    wake.notify_one();
+}
+
+//sleeps until there's input or timeout milliseconds have gone by, returns true if there was input
+bool waitevent(int timeout) {
+    //keys can be waiting without a callback having been missed (key repeats, or a key left over),
+    //this has to be checked without the lock held since polling the keyboard can run the callbacks
+    bool input = keypressed();
+    std::unique_lock<std::mutex> hold(lock);
+    if (!input) wake.wait_for(hold, std::chrono::milliseconds(timeout), [] { return pending; });
+    input = input || pending;
+    pending = false;
+    return input;
+}
+
+//sleeps until wakeevents() is called or timeout milliseconds have gone by, without looking at the
+//key buffer, for loops that read the keys themselves when they get round to it. Returns true if woken
+bool waitwake(int timeout) {
+    std::unique_lock<std::mutex> hold(lock);
+    bool woken = wake.wait_for(hold, std::chrono::milliseconds(timeout), [] { return pending; });
+    pending = false;
+    return woken;
+}
+
+//sleeps until a key is pressed, and returns it like readkey()
+int waitkey() {
+    while (!keypressed()) waitevent(keyTimeout);
+    return readkey();
+}
+
+//reads a key like readkey(), and finds out when it was pressed. Keys read some other way
+//are still remembered, so older presses are skipped until one matches this key
+int readkeytime(std::chrono::steady_clock::time_point *when) {
+    int key = readkey();
+    std::lock_guard<std::mutex> hold(lock);
+    *when = std::chrono::steady_clock::now();
+    while (keyCount > 0) {
+        int i = keyStart;
+        keyStart = (keyStart + 1) % keyHistory;
+        keyCount--;
+        if (keyCodes[i] == key) {
+            *when = keyTimes[i];
+            break;
+        }
+    }
+    return key;
+}
+
+//empties allegro's key buffer, and forgets when those keys were pressed
+void clearkeys() {
+    clear_keybuf();
+    std::lock_guard<std::mutex> hold(lock);
+    keyStart = keyCount = 0;
+}
+
+//the percentage of one core the program has used since installevents()
+double cpuusage() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    return elapsed.count() > 0 ? 100 * (cputime() - startCPU) / elapsed.count() : 0;
+}
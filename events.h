@@ -0,0 +1,24 @@
+/* Eddy Gao                     Serpens - Waiting for input                  ICS3U
+Lets the menus and prompts sleep until something happens instead of checking the
+keyboard and mouse over and over as fast as they can. Allegro tells us about every
+key and mouse movement through its callbacks, and those wake up whoever is waiting.
+The game's tick and frame timers wake it up as well, so it sleeps between ticks.
+The callbacks also note down when every key was pressed, so the game can tell how
+long it takes for a key press to show up on the screen.
+*/
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <chrono>
+
+void installevents();
+void removeevents();
+void wakeevents();
+bool waitevent(int timeout);
+bool waitwake(int timeout);
+int waitkey();
+int readkeytime(std::chrono::steady_clock::time_point *when);
+void clearkeys();
+double cpuusage();
+
+#endif
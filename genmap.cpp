@@ -0,0 +1,65 @@
+/* Eddy Gao                     Serpens - Map generator tool                 ICS3U
+Makes a new map from the command line, see mapgen.h for the styles.
+This does not need allegro, build it with:
+    g++ -O2 -pthread genmap.cpp mapgen.cpp analyze.cpp mapfile.cpp pool.cpp -o genmap
+Usage:
+    genmap [-s seed] [-j threads] style width height file
+The file is saved as a text map, or a binary one if its name ends in .smap. The same
+seed always makes the same map, the default seed is 1.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "mapgen.h"
+#include "analyze.h"
+#include "pool.h"
+
+//the most problems listed for the map, there shouldn't be any
+const int maxProblems = 8;
+
+int main(int argc, char **argv) {
+    uint64_t seed = 1;
+    int threads = numcores();
+    const char *args[4];
+    int count = 0;
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && count < 4) args[count++] = argv[i];
+        else count = 5;
+    }
+    int style = count == 4 ? findstyle(args[0]) : -1;
+    int width = count == 4 ? atoi(args[1]) : 0, height = count == 4 ? atoi(args[2]) : 0;
+    if (style == -1 || width < 1 || height < 1) {
+        fprintf(stderr, "usage: %s [-s seed] [-j threads] style width height file\nstyles:", argv[0]);
+        for (int i=0; i<numStyles; i++) fprintf(stderr, " %s", stylename(i));
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    mapdata m;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!genmap(&m, style, width, height, seed, threads)) {
+        fprintf(stderr, "not enough memory for a %d x %d map\n", width, height);
+        return 1;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    printf("made a %d x %d %s map in %.1f ms on %d thread%s\n", width, height, stylename(style), elapsed.count(), threads, threads == 1 ? "" : "s");
+
+    mapreport r;
+    char problems[maxProblems][128];
+    analyzemap(&r, m.tiles, m.width, m.height, m.spawnx, m.spawny);
+    int n = mapproblems(&r, problems, maxProblems);
+    printf("spawn (%d, %d), %ld open squares, %ld in dead ends\n", r.spawnx, r.spawny, r.open, r.deadEnds);
+    for (int p=0; p<n; p++) printf("problem: %s\n", problems[p]);
+
+    bool saved = writemap(&m, args[3]);
+    freemap(&m);
+    if (!saved) {
+        fprintf(stderr, "could not save to %s\n", args[3]);
+        return 1;
+    }
+    return 0;
+}
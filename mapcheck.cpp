@@ -0,0 +1,76 @@
+/* Eddy Gao                     Serpens - Map checker                        ICS3U
+Checks maps for problems from the command line, see analyze.h for what it looks for.
+This does not need allegro, build it with:
+    g++ -O2 mapcheck.cpp analyze.cpp mapfile.cpp -o mapcheck
+Usage:
+    mapcheck [-q] [map files...]
+With no map files it checks every map in maps/. -q only prints the maps that have
+problems. It exits with 1 if any map has a problem or can't be read, so it can be
+run before maps are shipped.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "analyze.h"
+#include "mapfile.h"
+
+//the most problems listed for one map
+const int maxProblems = 8;
+
+//every .txt and .smap map in a directory, sorted by name
+void findmaps(const char *dir, std::vector<std::string> *maps) {
+    DIR *d = opendir(dir);
+    if (d == NULL) return;
+    struct dirent *f;
+    while ((f = readdir(d)) != NULL) {
+        const char *ext = strrchr(f->d_name, '.');
+        if (ext != NULL && (strcmp(ext, ".txt") == 0 || strcmp(ext, ".smap") == 0)) maps->push_back(std::string(dir) + "/" + f->d_name);
+    }
+    closedir(d);
+    std::sort(maps->begin(), maps->end());
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> maps;
+    bool quiet = false;
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) quiet = true;
+        else maps.push_back(argv[i]);
+    }
+    if (maps.empty()) findmaps("maps", &maps);
+
+    int bad = 0;
+    for (size_t i=0; i<maps.size(); i++) {
+        mapdata m;
+        if (!readmap(&m, maps[i].c_str())) {
+            printf("%s: can't be read\n", maps[i].c_str());
+            bad++;
+            continue;
+        }
+        mapreport r;
+        char problems[maxProblems][128];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        analyzemap(&r, m.tiles, m.width, m.height, m.spawnx, m.spawny);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        int n = mapproblems(&r, problems, maxProblems);
+        freemap(&m);
+        if (n > 0) bad++;
+        if (quiet && n == 0) continue;
+
+        printf("%s: %d x %d, checked in %.2f ms\n", maps[i].c_str(), r.width, r.height, elapsed.count());
+        printf("    spawn (%d, %d) with %d way%s out\n", r.spawnx, r.spawny, r.spawnDegree, r.spawnDegree == 1 ? "" : "s");
+        printf("    %ld open squares in %d area%s, %ld reachable from the spawn\n", r.open, r.regions, r.regions == 1 ? "" : "s", r.reachable);
+        printf("    %ld food squares, %ld unreachable\n", r.fertile, r.unreachableFertile);
+        printf("    %ld square%s in dead ends, biggest loop safe area %ld", r.deadEnds, r.deadEnds == 1 ? "" : "s", r.loopSafe);
+        if (r.loopx != -1) printf(" around (%d, %d)", r.loopx, r.loopy);
+        printf("\n");
+        for (int p=0; p<n; p++) printf("    problem: %s\n", problems[p]);
+    }
+    if (maps.empty()) printf("no maps to check\n");
+    return bad > 0 ? 1 : 0;
+}
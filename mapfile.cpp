@@ -0,0 +1,265 @@
+/* Eddy Gao                     Serpens - Map files                          ICS3U
+Map loading and saving. See mapfile.h.
+
+The binary format is laid out like this, every number is a 32 bit little endian integer:
+    "SMAP"              magic
+    version             always 1
+    width, height
+    spawnx, spawny      -1 if the map has no spawn point
+Then every row, one after another, as runs of squares of the same type. Each run
+is one byte: the top 2 bits are the MapTile, and the bottom 6 bits are the length
+of the run minus one. A run never goes past the end of its row.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "mapfile.h"
+
+//the biggest map that will be loaded, so sizes in a bad file can't overflow
+const long maxSquares = 1L << 30;
+
+//maps a whole file into memory so it can be read without copying it, handle is needed to close it again
+static const char *mapopen(const char *path, long *size, void **handle) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart > 0x7fffffff) {
+        CloseHandle(file);
+        return NULL;
+    }
+    *size = (long)length.QuadPart;
+    *handle = NULL;
+    if (*size == 0) {
+        CloseHandle(file);
+        return "";
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return NULL;
+    const char *data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+    *handle = mapping;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+    *size = (long)st.st_size;
+    *handle = NULL;
+    if (*size == 0) {
+        close(fd);
+        return "";
+    }
+    void *data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    return (const char*)data;
+#endif
+}
+
+static void mapclose(const char *data, long size, void *handle) {
+    if (size == 0) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)handle);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
+//turns a row of map characters into MapTiles
+static void classify(unsigned char *out, const char *in, long n) {
+    long i = 0;
+#ifdef __SSE2__
+    //16 squares at a time: compare against each character, and keep the tile type where it matched
+    const __m128i wall = _mm_set1_epi8('#'), spawn = _mm_set1_epi8('s'), infertile = _mm_set1_epi8('x');
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i t = _mm_and_si128(_mm_cmpeq_epi8(v, wall), _mm_set1_epi8(MapWall));
+        t = _mm_or_si128(t, _mm_and_si128(_mm_cmpeq_epi8(v, spawn), _mm_set1_epi8(MapSpawn)));
+        t = _mm_or_si128(t, _mm_and_si128(_mm_cmpeq_epi8(v, infertile), _mm_set1_epi8(MapInfertile)));
+        _mm_storeu_si128((__m128i*)(out + i), t);
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = in[i] == '#' ? MapWall : in[i] == 's' ? MapSpawn : in[i] == 'x' ? MapInfertile : MapEmpty;
+    }
+}
+
+//finds the length of the line starting at p, without its line ending, and where the next line starts
+static long nextline(const char *p, const char *end, const char **next) {
+    const char *nl = (const char*)memchr(p, '\n', end - p);
+    const char *eol = nl ? nl : end;
+    *next = nl ? nl + 1 : end;
+    if (eol > p && eol[-1] == '\r') eol--;
+    return eol - p;
+}
+
+//text maps are as wide as their longest line and as tall as their number of lines
+static bool parsetext(mapdata *m, const char *data, long size) {
+    const char *p, *next, *end = data + size;
+    long width = 0, height = 0, lines = 0;
+
+    //work out the size of the map, blank lines at the end don't count
+    for (p = data; p < end; p = next) {
+        long len = nextline(p, end, &next);
+        lines++;
+        if (len > 0) height = lines;
+        if (len > width) width = len;
+    }
+    if (width == 0 || width * height > maxSquares || !allocmap(m, width, height)) return false;
+
+    //read in map data, anything missing from the end of a short line is empty
+    p = data;
+    for (int y=0; y<height; y++, p = next) {
+        long len = nextline(p, end, &next);
+        classify(m->tiles + (long)y*width, p, len);
+        const char *s = (const char*)memchr(p, 's', len);
+        if (s != NULL) {
+            m->spawnx = s - p;
+            m->spawny = y;
+        }
+    }
+    return true;
+}
+
+static uint32_t read32(const char *p) {
+    const unsigned char *u = (const unsigned char*)p;
+    return u[0] | (u[1] << 8) | (u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+static bool parsebinary(mapdata *m, const char *data, long size) {
+    if (size < 24 || read32(data + 4) != 1) return false;
+    long width = read32(data + 8), height = read32(data + 12);
+    if (width < 1 || height < 1 || width > maxSquares || width * height > maxSquares) return false;
+    if (!allocmap(m, width, height)) return false;
+    m->spawnx = (int32_t)read32(data + 16);
+    m->spawny = (int32_t)read32(data + 20);
+    if (m->spawnx >= width || m->spawny >= height || m->spawnx < 0 || m->spawny < 0) m->spawnx = m->spawny = -1;
+
+    const unsigned char *p = (const unsigned char*)data + 24, *end = (const unsigned char*)data + size;
+    unsigned char *row = m->tiles;
+    for (long y=0; y<height; y++, row += width) {
+        for (long x=0; x<width; ) {
+            if (p == end) {
+                freemap(m);
+                return false;
+            }
+            int tile = *p >> 6, len = (*p & 63) + 1;
+            p++;
+            if (x + len > width) {
+                freemap(m);
+                return false;
+            }
+            //most runs are short, so fill them directly rather than calling memset
+            unsigned char *out = row + x;
+            if (len > 16) memset(out, tile, len);
+            else for (int i=0; i<len; i++) out[i] = tile;
+            x += len;
+        }
+    }
+    return true;
+}
+
+//loads a map from memory, working out which format it's in
+bool parsemap(mapdata *m, const char *data, long size) {
+    m->tiles = NULL;
+    if (size >= 4 && memcmp(data, "SMAP", 4) == 0) return parsebinary(m, data, size);
+    return parsetext(m, data, size);
+}
+
+//loads a map from a file in either format
+bool readmap(mapdata *m, const char *path) {
+    long size;
+    void *handle;
+    const char *data = mapopen(path, &size, &handle);
+
+    //make sure that we get a valid file
+    if (data == NULL) return false;
+
+    bool ok = parsemap(m, data, size);
+    mapclose(data, size, handle);
+    return ok;
+}
+
+static void write32(FILE *f, int32_t n) {
+    unsigned char b[4] = {(unsigned char)n, (unsigned char)(n >> 8), (unsigned char)(n >> 16), (unsigned char)(n >> 24)};
+    fwrite(b, 1, 4, f);
+}
+
+//saves a map, in the binary format if the file name ends in .smap and as text otherwise
+bool writemap(const mapdata *m, const char *path) {
+    const char *ext = strrchr(path, '.');
+    bool binary = ext != NULL && strcmp(ext, ".smap") == 0;
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) return false;
+
+    if (binary) {
+        fwrite("SMAP", 1, 4, f);
+        write32(f, 1);
+        write32(f, m->width);
+        write32(f, m->height);
+        write32(f, m->spawnx);
+        write32(f, m->spawny);
+        for (int y=0; y<m->height; y++) {
+            const unsigned char *row = m->tiles + (long)y*m->width;
+            for (int x=0; x<m->width; ) {
+                int len = 1;
+                while (len < 64 && x + len < m->width && row[x + len] == row[x]) len++;
+                fputc((row[x] << 6) | (len - 1), f);
+                x += len;
+            }
+        }
+    } else {
+        const char letters[] = ".#sx";
+        char *line = (char*)malloc(m->width + 1);
+        if (line == NULL) {
+            fclose(f);
+            return false;
+        }
+        for (int y=0; y<m->height; y++) {
+            const unsigned char *row = m->tiles + (long)y*m->width;
+            for (int x=0; x<m->width; x++) line[x] = letters[row[x] & 3];
+            line[m->width] = '\n';
+            fwrite(line, 1, m->width + 1, f);
+        }
+        free(line);
+    }
+
+    return fclose(f) == 0;
+}
+
+//makes an empty map with no spawn point
+bool allocmap(mapdata *m, int width, int height) {
+    m->tiles = (unsigned char*)calloc((long)width * height, 1);
+    m->width = width;
+    m->height = height;
+    m->spawnx = -1;
+    m->spawny = -1;
+    return m->tiles != NULL;
+}
+
+void freemap(mapdata *m) {
+    free(m->tiles);
+    m->tiles = NULL;
+}
@@ -0,0 +1,33 @@
+/* Eddy Gao                     Serpens - Map files                          ICS3U
+Reading and writing maps, shared by the game and the mapmaker.
+Maps come in two formats:
+    Text, one line per row of the map: '.' is empty, '#' is a wall, 'x' is
+    infertile and 's' is the spawn point.
+    Binary (.smap), a header followed by every row run-length encoded. See
+    mapfile.cpp for the layout.
+Either kind is loaded by memory mapping the file and parsing it in one pass.
+*/
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+//types of map squares, the same numbers the mapmaker uses for its brushes
+enum MapTile {
+    MapEmpty = 0,
+    MapWall,
+    MapSpawn,
+    MapInfertile
+};
+
+typedef struct mapdata {
+    int width, height;
+    int spawnx, spawny;     //-1 if the map has no spawn point
+    unsigned char *tiles;   //one MapTile per square, one row after another
+} mapdata;
+
+bool readmap(mapdata *m, const char *path);
+bool parsemap(mapdata *m, const char *data, long size);
+bool writemap(const mapdata *m, const char *path);
+bool allocmap(mapdata *m, int width, int height);
+void freemap(mapdata *m);
+
+#endif
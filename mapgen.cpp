@@ -0,0 +1,506 @@
+/* Eddy Gao                     Serpens - Map generator                      ICS3U
+Making maps from a seed. See mapgen.h.
+Every style works in passes, and each pass is split into jobs that only write to
+their own part of the map, so the threads never touch the same square.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "mapgen.h"
+#include "analyze.h"
+#include "pool.h"
+#include "rng.h"
+#include "trace.h"
+
+//the size of the blocks the map is cut into, in maze cells for mazes and squares otherwise
+const int mazeBlock = 64, caveStrip = 64, arenaBlock = 64, roomBlock = 32;
+//how many times the cave automaton is run, it has to be even to end up back in the map
+const int caveSteps = 4;
+//out of 100, how much of the noise caves start from is wall
+const int caveWalls = 45;
+const unsigned char noLoop = 255;
+
+const char *styleNames[numStyles] = {"backtracker", "kruskal", "caves", "symmetric", "rooms"};
+
+//the ways out of a maze cell, east, south, west and north
+const int dx[4] = {1, 0, -1, 0}, dy[4] = {0, 1, 0, -1};
+
+typedef struct generator {
+    mapdata *m;
+    int style;
+    uint64_t seed;
+    int blocksx, blocksy;
+    //mazes have a cell on every square with even x and y, and the squares between them are
+    //passages. A passage goes round the edge if the map's size is even that way
+    int cellsx, cellsy;
+    bool wrapx, wrapy;
+    std::vector<unsigned char> loops;   //the way each maze cell is knocked through, or noLoop
+    //the second copy of the map the cave automaton goes back and forth with, or the quarter
+    //of a symmetric arena that's mirrored
+    std::vector<unsigned char> other;
+    int step;
+    //a square in each room that the corridors go to
+    std::vector<int> roomx, roomy;
+} generator;
+
+const char *stylename(int style) {
+    return style >= 0 && style < numStyles ? styleNames[style] : "unknown";
+}
+
+//the style with the given name, or -1
+int findstyle(const char *name) {
+    for (int i=0; i<numStyles; i++) {
+        if (strcmp(name, styleNames[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+//the random numbers for one job of a pass. They only depend on the seed and which job it is,
+//so the map comes out the same whichever thread does the job
+static void jobrng(rng *r, generator *g, int pass, int job) {
+    rngseed(r, mix(g->seed + mix(((uint64_t)pass << 32) + job)));
+}
+
+//the first and one past the last of n things that part i of parts gets
+static void share(int n, int parts, int i, int *begin, int *end) {
+    *begin = (long)n * i / parts;
+    *end = (long)n * (i + 1) / parts;
+}
+
+static unsigned char *square(generator *g, int x, int y) {
+    return &g->m->tiles[(long)y * g->m->width + x];
+}
+
+//the cell next to (i, j) going way d, false if there isn't one
+static bool nextcell(generator *g, int i, int j, int d, int *ni, int *nj) {
+    *ni = i + dx[d];
+    *nj = j + dy[d];
+    if (*ni < 0 || *ni >= g->cellsx) {
+        if (!g->wrapx) return false;
+        *ni = (*ni + g->cellsx) % g->cellsx;
+    }
+    if (*nj < 0 || *nj >= g->cellsy) {
+        if (!g->wrapy) return false;
+        *nj = (*nj + g->cellsy) % g->cellsy;
+    }
+    return *ni != i || *nj != j;
+}
+
+//the passage out of cell (i, j) going way d, NULL if there's no cell that way
+static unsigned char *passage(generator *g, int i, int j, int d) {
+    //away from the edges there's always a cell on the other side
+    if (i > 0 && j > 0 && i < g->cellsx - 1 && j < g->cellsy - 1) return square(g, 2*i + dx[d], 2*j + dy[d]);
+    int ni, nj;
+    if (!nextcell(g, i, j, d, &ni, &nj)) return NULL;
+    int w = g->m->width, h = g->m->height;
+    return square(g, (2*i + dx[d] + w) % w, (2*j + dy[d] + h) % h);
+}
+
+//the cells in a maze block
+static void blockcells(generator *g, int block, int *i0, int *i1, int *j0, int *j1) {
+    share(g->cellsx, g->blocksx, block % g->blocksx, i0, i1);
+    share(g->cellsy, g->blocksy, block / g->blocksx, j0, j1);
+}
+
+//makes a maze inside one block by wandering off in random directions and backing up when
+//stuck, without leaving the block. Visited cells are the ones that aren't walls any more
+static void backtrack(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int i0, i1, j0, j1;
+    rng r;
+    jobrng(&r, g, 0, job);
+    blockcells(g, job, &i0, &i1, &j0, &j1);
+    int bw = i1 - i0, bh = j1 - j0;
+    if (bw < 1 || bh < 1) return;
+    std::vector<int> stack;
+    stack.reserve(bw * bh);
+    int start = rngrange(&r, bw * bh);
+    stack.push_back(start);
+    *square(g, 2*(i0 + start % bw), 2*(j0 + start / bw)) = MapEmpty;
+    while (!stack.empty()) {
+        int c = stack.back(), i = c % bw, j = c / bw, ways[4], n = 0;
+        for (int d=0; d<4; d++) {
+            int ni = i + dx[d], nj = j + dy[d];
+            if (ni >= 0 && ni < bw && nj >= 0 && nj < bh && *square(g, 2*(i0 + ni), 2*(j0 + nj)) == MapWall) ways[n++] = d;
+        }
+        if (n == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int d = ways[rngrange(&r, n)];
+        *square(g, 2*(i0 + i) + dx[d], 2*(j0 + j) + dy[d]) = MapEmpty;
+        *square(g, 2*(i0 + i + dx[d]), 2*(j0 + j + dy[d])) = MapEmpty;
+        stack.push_back((j + dy[d]) * bw + i + dx[d]);
+    }
+}
+
+static int findset(std::vector<int> &parent, int a) {
+    while (parent[a] != a) {
+        parent[a] = parent[parent[a]];
+        a = parent[a];
+    }
+    return a;
+}
+
+//makes a maze inside one block by knocking down the walls between cells in a random order,
+//skipping any wall whose cells are already joined up some other way
+static void kruskal(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int i0, i1, j0, j1;
+    rng r;
+    jobrng(&r, g, 0, job);
+    blockcells(g, job, &i0, &i1, &j0, &j1);
+    int bw = i1 - i0, bh = j1 - j0;
+    if (bw < 1 || bh < 1) return;
+    std::vector<int> parent(bw * bh), walls;
+    walls.reserve(2 * bw * bh);
+    for (int c=0; c<bw*bh; c++) {
+        parent[c] = c;
+        *square(g, 2*(i0 + c % bw), 2*(j0 + c / bw)) = MapEmpty;
+        //each wall is a cell and whether it's the one east or south of it
+        if (c % bw + 1 < bw) walls.push_back(c * 2);
+        if (c / bw + 1 < bh) walls.push_back(c * 2 + 1);
+    }
+    for (int k=(int)walls.size() - 1; k>0; k--) {
+        int swap = rngrange(&r, k + 1), t = walls[k];
+        walls[k] = walls[swap];
+        walls[swap] = t;
+    }
+    for (size_t k=0; k<walls.size(); k++) {
+        int c = walls[k] / 2, d = walls[k] % 2, other = d == 0 ? c + 1 : c + bw;
+        int a = findset(parent, c), b = findset(parent, other);
+        if (a == b) continue;
+        parent[a] = b;
+        *square(g, 2*(i0 + c % bw) + dx[d], 2*(j0 + c / bw) + dy[d]) = MapEmpty;
+    }
+}
+
+//joins the blocks' mazes into one, through one passage for every pair of blocks on a random
+//spanning tree of them, so it's still a maze without loops
+static void joinblocks(generator *g) {
+    int blocks = g->blocksx * g->blocksy;
+    std::vector<int> parent(blocks), links;
+    rng r;
+    jobrng(&r, g, 1, 0);
+    for (int b=0; b<blocks; b++) {
+        parent[b] = b;
+        if (g->blocksx > 1 && (g->wrapx || b % g->blocksx + 1 < g->blocksx)) links.push_back(b * 2);
+        if (g->blocksy > 1 && (g->wrapy || b / g->blocksx + 1 < g->blocksy)) links.push_back(b * 2 + 1);
+    }
+    for (int k=(int)links.size() - 1; k>0; k--) {
+        int swap = rngrange(&r, k + 1), t = links[k];
+        links[k] = links[swap];
+        links[swap] = t;
+    }
+    for (size_t k=0; k<links.size(); k++) {
+        int b = links[k] / 2, d = links[k] % 2, bx = b % g->blocksx, by = b / g->blocksx;
+        int other = d == 0 ? by * g->blocksx + (bx + 1) % g->blocksx : (by + 1) % g->blocksy * g->blocksx + bx;
+        int a = findset(parent, b), o = findset(parent, other);
+        if (a == o) continue;
+        parent[a] = o;
+        //a random cell on the block's east or south edge
+        int i0, i1, j0, j1;
+        blockcells(g, b, &i0, &i1, &j0, &j1);
+        int i = d == 0 ? i1 - 1 : i0 + rngrange(&r, i1 - i0), j = d == 0 ? j0 + rngrange(&r, j1 - j0) : j1 - 1;
+        unsigned char *p = passage(g, i, j, d);
+        if (p != NULL) *p = MapEmpty;
+    }
+}
+
+//picks which of a block's dead ends to knock through and which way, without changing the map
+//yet since other blocks are still looking at it
+static void pickloops(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int i0, i1, j0, j1;
+    rng r;
+    jobrng(&r, g, 2, job);
+    blockcells(g, job, &i0, &i1, &j0, &j1);
+    for (int j=j0; j<j1; j++) {
+        for (int i=i0; i<i1; i++) {
+            unsigned char *ways[4];
+            int closed[4], n = 0, open = 0;
+            for (int d=0; d<4; d++) {
+                ways[d] = passage(g, i, j, d);
+                if (ways[d] != NULL) open += *ways[d] != MapWall;
+            }
+            g->loops[(long)j * g->cellsx + i] = noLoop;
+            if (open != 1 || rngrange(&r, 100) >= mazeLoops) continue;
+            for (int d=0; d<4; d++) {
+                if (ways[d] != NULL && *ways[d] == MapWall) closed[n++] = d;
+            }
+            if (n > 0) g->loops[(long)j * g->cellsx + i] = closed[rngrange(&r, n)];
+        }
+    }
+}
+
+//knocks through what pickloops picked. Each cell opens its own east and south passages,
+//if it picked them or the cell on the other side picked that passage going west or north
+static void openloops(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int i0, i1, j0, j1;
+    blockcells(g, job, &i0, &i1, &j0, &j1);
+    for (int j=j0; j<j1; j++) {
+        for (int i=i0; i<i1; i++) {
+            for (int d=0; d<2; d++) {
+                int ni, nj;
+                if (!nextcell(g, i, j, d, &ni, &nj)) continue;
+                if (g->loops[(long)j * g->cellsx + i] == d || g->loops[(long)nj * g->cellsx + ni] == d + 2) *passage(g, i, j, d) = MapEmpty;
+            }
+        }
+    }
+}
+
+static void maze(generator *g, int threads) {
+    mapdata *m = g->m;
+    g->cellsx = (m->width + 1) / 2;
+    g->cellsy = (m->height + 1) / 2;
+    //with an odd size the last cells are right up against the first ones, so they can't be joined
+    g->wrapx = m->width % 2 == 0;
+    g->wrapy = m->height % 2 == 0;
+    g->blocksx = (g->cellsx + mazeBlock - 1) / mazeBlock;
+    g->blocksy = (g->cellsy + mazeBlock - 1) / mazeBlock;
+    int blocks = g->blocksx * g->blocksy;
+    memset(m->tiles, MapWall, (long)m->width * m->height);
+    runjobs(blocks, threads, g->style == StyleKruskal ? kruskal : backtrack, g);
+    joinblocks(g);
+    g->loops.resize((long)g->cellsx * g->cellsy);
+    runjobs(blocks, threads, pickloops, g);
+    runjobs(blocks, threads, openloops, g);
+}
+
+//fills a strip of rows with random noise for the caves to grow from
+static void cavenoise(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int y0, y1;
+    rng r;
+    jobrng(&r, g, 0, job);
+    share(g->m->height, g->blocksy, job, &y0, &y1);
+    for (long c=(long)y0 * g->m->width; c<(long)y1 * g->m->width; c++) g->m->tiles[c] = rngrange(&r, 100) < caveWalls ? MapWall : MapEmpty;
+}
+
+//one step of the automaton for a strip of rows: a square becomes a wall if 5 or more of the 9
+//squares around it (counting itself) are walls. Walls are 1 and empty squares 0, so the
+//count is the sum of each column of 3, added up 3 columns at a time
+static void cavestep(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int width = g->m->width, height = g->m->height, y0, y1;
+    const unsigned char *from = g->step % 2 == 0 ? g->m->tiles : &g->other[0];
+    unsigned char *to = g->step % 2 == 0 ? &g->other[0] : g->m->tiles;
+    std::vector<unsigned char> columns(width);
+    share(height, g->blocksy, job, &y0, &y1);
+    for (int y=y0; y<y1; y++) {
+        const unsigned char *up = from + (long)((y + height - 1) % height) * width;
+        const unsigned char *row = from + (long)y * width;
+        const unsigned char *down = from + (long)((y + 1) % height) * width;
+        unsigned char *out = to + (long)y * width, *sum = &columns[0];
+        for (int x=0; x<width; x++) sum[x] = up[x] + row[x] + down[x];
+        for (int x=1; x<width-1; x++) out[x] = sum[x-1] + sum[x] + sum[x+1] >= 5;
+        out[0] = sum[width-1] + sum[0] + sum[width > 1 ? 1 : 0] >= 5;
+        if (width > 1) out[width-1] = sum[width-2] + sum[width-1] + sum[0] >= 5;
+    }
+}
+
+static void caves(generator *g, int threads) {
+    g->blocksy = (g->m->height + caveStrip - 1) / caveStrip;
+    g->other.resize((long)g->m->width * g->m->height);
+    runjobs(g->blocksy, threads, cavenoise, g);
+    for (g->step=0; g->step<caveSteps; g->step++) runjobs(g->blocksy, threads, cavestep, g);
+}
+
+//scatters walls over one block of the quarter: rectangles and bars, kept a square away from
+//the block's edges so there's always a way between blocks
+static void arenablock(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int qw = (g->m->width + 1) / 2, qh = (g->m->height + 1) / 2, x0, x1, y0, y1;
+    rng r;
+    jobrng(&r, g, 0, job);
+    share(qw, g->blocksx, job % g->blocksx, &x0, &x1);
+    share(qh, g->blocksy, job / g->blocksx, &y0, &y1);
+    for (int y=y0; y<y1; y++) memset(&g->other[(long)y * qw + x0], MapEmpty, x1 - x0);
+    int bw = x1 - x0 - 2, bh = y1 - y0 - 2;
+    if (bw < 2 || bh < 2) return;
+    int shapes = bw * bh / 40;
+    for (int s=0; s<shapes; s++) {
+        int w, h;
+        if (rngrange(&r, 2) == 0) {
+            w = 1 + rngrange(&r, 4);
+            h = 1 + rngrange(&r, 4);
+        } else if (rngrange(&r, 2) == 0) {
+            w = 1;
+            h = 2 + rngrange(&r, 10);
+        } else {
+            w = 2 + rngrange(&r, 10);
+            h = 1;
+        }
+        if (w > bw) w = bw;
+        if (h > bh) h = bh;
+        int sx = x0 + 1 + rngrange(&r, bw - w + 1), sy = y0 + 1 + rngrange(&r, bh - h + 1);
+        for (int y=sy; y<sy+h; y++) memset(&g->other[(long)y * qw + sx], MapWall, w);
+    }
+}
+
+//copies the quarter into a strip of rows of the map, mirrored left to right and top to bottom
+static void arenamirror(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int width = g->m->width, height = g->m->height, qw = (width + 1) / 2, qh = (height + 1) / 2, y0, y1;
+    share(height, (height + caveStrip - 1) / caveStrip, job, &y0, &y1);
+    for (int y=y0; y<y1; y++) {
+        const unsigned char *from = &g->other[(long)(y < qh ? y : height - 1 - y) * qw];
+        unsigned char *row = g->m->tiles + (long)y * width;
+        for (int x=0; x<qw; x++) row[x] = row[width - 1 - x] = from[x];
+    }
+}
+
+static void symmetric(generator *g, int threads) {
+    int qw = (g->m->width + 1) / 2, qh = (g->m->height + 1) / 2;
+    g->blocksx = (qw + arenaBlock - 1) / arenaBlock;
+    g->blocksy = (qh + arenaBlock - 1) / arenaBlock;
+    g->other.resize((long)qw * qh);
+    runjobs(g->blocksx * g->blocksy, threads, arenablock, g);
+    runjobs((g->m->height + caveStrip - 1) / caveStrip, threads, arenamirror, g);
+}
+
+//walls in a block and carves a random room out of it, leaving a square of wall at the edges
+//when there's room to
+static void roomblock(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    int x0, x1, y0, y1;
+    rng r;
+    jobrng(&r, g, 0, job);
+    share(g->m->width, g->blocksx, job % g->blocksx, &x0, &x1);
+    share(g->m->height, g->blocksy, job / g->blocksx, &y0, &y1);
+    for (int y=y0; y<y1; y++) memset(square(g, x0, y), MapWall, x1 - x0);
+    int bw = x1 - x0, bh = y1 - y0, room[2][2];
+    for (int k=0; k<2; k++) {
+        int size = k == 0 ? bw : bh, start = k == 0 ? x0 : y0, inner = size > 2 ? size - 2 : size;
+        int length = inner / 3 + rngrange(&r, inner - inner / 3) + 1;
+        if (length > inner) length = inner;
+        room[k][0] = start + (size - inner) / 2 + rngrange(&r, inner - length + 1);
+        room[k][1] = length;
+    }
+    for (int y=room[1][0]; y<room[1][0]+room[1][1]; y++) memset(square(g, room[0][0], y), MapEmpty, room[0][1]);
+    g->roomx[job] = room[0][0] + rngrange(&r, room[0][1]);
+    g->roomy[job] = room[1][0] + rngrange(&r, room[1][1]);
+}
+
+//carves a corridor along a row or column from a to b. If around is set it heads forwards,
+//going round the edge if it has to and all the way round if a and b are the same, otherwise
+//it goes straight there
+static void corridor(generator *g, bool across, int at, int a, int b, bool around) {
+    int size = across ? g->m->width : g->m->height;
+    if (!around) {
+        for (int i=(a < b ? a : b); i<=(a < b ? b : a); i++) *(across ? square(g, i, at) : square(g, at, i)) = MapEmpty;
+        return;
+    }
+    int i = a;
+    do {
+        *(across ? square(g, i, at) : square(g, at, i)) = MapEmpty;
+        i = (i + 1) % size;
+    } while (i != b);
+    *(across ? square(g, b, at) : square(g, at, b)) = MapEmpty;
+}
+
+//joins every room in a row of blocks to the one east of it, going round the edge at the end.
+//The corridor stays in the row of blocks, so the rows can be done at the same time
+static void roomseast(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    rng r;
+    jobrng(&r, g, 1, job);
+    for (int bx=0; bx<g->blocksx; bx++) {
+        int a = job * g->blocksx + bx, b = job * g->blocksx + (bx + 1) % g->blocksx;
+        if (rngrange(&r, 2) == 0) {
+            corridor(g, true, g->roomy[a], g->roomx[a], g->roomx[b], true);
+            corridor(g, false, g->roomx[b], g->roomy[a], g->roomy[b], false);
+        } else {
+            corridor(g, false, g->roomx[a], g->roomy[a], g->roomy[b], false);
+            corridor(g, true, g->roomy[b], g->roomx[a], g->roomx[b], true);
+        }
+    }
+}
+
+//joins every room in a column of blocks to the one south of it, the same way
+static void roomssouth(int job, int worker, void *data) {
+    generator *g = (generator*)data;
+    rng r;
+    jobrng(&r, g, 2, job);
+    for (int by=0; by<g->blocksy; by++) {
+        int a = by * g->blocksx + job, b = (by + 1) % g->blocksy * g->blocksx + job;
+        if (rngrange(&r, 2) == 0) {
+            corridor(g, false, g->roomx[a], g->roomy[a], g->roomy[b], true);
+            corridor(g, true, g->roomy[b], g->roomx[a], g->roomx[b], false);
+        } else {
+            corridor(g, true, g->roomy[a], g->roomx[a], g->roomx[b], false);
+            corridor(g, false, g->roomx[b], g->roomy[a], g->roomy[b], true);
+        }
+    }
+}
+
+static void rooms(generator *g, int threads) {
+    //the nearest number of blocks to roomBlock squares each
+    g->blocksx = (g->m->width + roomBlock / 2) / roomBlock > 0 ? (g->m->width + roomBlock / 2) / roomBlock : 1;
+    g->blocksy = (g->m->height + roomBlock / 2) / roomBlock > 0 ? (g->m->height + roomBlock / 2) / roomBlock : 1;
+    g->roomx.resize(g->blocksx * g->blocksy);
+    g->roomy.resize(g->blocksx * g->blocksy);
+    runjobs(g->blocksx * g->blocksy, threads, roomblock, g);
+    runjobs(g->blocksy, threads, roomseast, g);
+    runjobs(g->blocksx, threads, roomssouth, g);
+}
+
+//open squares next to (x, y), going round the edges
+static int openaround(mapdata *m, int x, int y) {
+    int n = 0;
+    for (int d=0; d<4; d++) {
+        int nx = (x + dx[d] + m->width) % m->width, ny = (y + dy[d] + m->height) % m->height;
+        n += m->tiles[(long)ny * m->width + nx] != MapWall;
+    }
+    return n;
+}
+
+//puts the spawn point on the first open square from the middle of the map on that has at least
+//two ways out, or just the first open square. A map with nothing open is cleared
+static void placespawn(mapdata *m) {
+    long squares = (long)m->width * m->height, middle = (long)(m->height / 2) * m->width + m->width / 2, found = -1;
+    for (long k=0; k<squares; k++) {
+        long c = (middle + k) % squares;
+        if (m->tiles[c] == MapWall) continue;
+        if (found == -1) found = c;
+        if (openaround(m, c % m->width, c / m->width) >= 2) {
+            found = c;
+            break;
+        }
+    }
+    if (found == -1) {
+        memset(m->tiles, MapEmpty, squares);
+        found = middle;
+    }
+    m->tiles[found] = MapSpawn;
+    m->spawnx = found % m->width;
+    m->spawny = found / m->width;
+}
+
+bool genmap(mapdata *m, int style, int width, int height, uint64_t seed, int threads) {
+    TRACE("genmap");
+    if (style < 0 || style >= numStyles || !allocmap(m, width, height)) return false;
+    if (threads < 1) threads = numcores();
+    generator g;
+    g.m = m;
+    g.style = style;
+    g.seed = seed;
+    g.blocksx = g.blocksy = 1;
+    if (style == StyleBacktracker || style == StyleKruskal) maze(&g, threads);
+    else if (style == StyleCaves) caves(&g, threads);
+    else if (style == StyleSymmetric) symmetric(&g, threads);
+    else rooms(&g, threads);
+    //mazes and rooms are joined up already, the others can have pieces cut off
+    if (style == StyleCaves || style == StyleSymmetric) keepbiggest(m->tiles, width, height);
+    placespawn(m);
+    return true;
+}
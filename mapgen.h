@@ -0,0 +1,39 @@
+/* Eddy Gao                     Serpens - Map generator                      ICS3U
+Makes new maps from a seed, so a fresh arena can be made for every round. The same
+seed and size always make the same map, however many threads make it. The styles:
+    backtracker and kruskal, mazes with corridors one square wide made by a random
+    depth first search or by joining up random walls with union-find. Some of
+    their dead ends are knocked through, so there are loops for the snake to use.
+    caves, grown from random noise with a cellular automaton.
+    symmetric, walls scattered over one quarter and mirrored into the other three.
+    rooms, a grid of rooms each joined to the next ones by corridors.
+The map is cut into blocks that are made on every core at once (see pool.h), each
+with its own random numbers, and then joined together. Everything wraps around the
+edges like the game does, and every open square can be reached from the spawn
+point: anything that got cut off is walled in. A 4096 x 4096 map takes a few
+hundred milliseconds on one core. genmap.cpp makes maps from the command line.
+*/
+#ifndef MAPGEN_H
+#define MAPGEN_H
+
+#include <stdint.h>
+#include "mapfile.h"
+
+enum MapStyle {
+    StyleBacktracker = 0,
+    StyleKruskal,
+    StyleCaves,
+    StyleSymmetric,
+    StyleRooms
+};
+const int numStyles = StyleRooms + 1;
+
+//how many of a maze's dead ends, out of 100, get knocked through into loops
+const int mazeLoops = 60;
+
+const char *stylename(int style);
+int findstyle(const char *name);
+//makes a new map in m (which is allocated here), threads is how many to use, 0 for every core
+bool genmap(mapdata *m, int style, int width, int height, uint64_t seed, int threads);
+
+#endif
@@ -0,0 +1,249 @@
+/* Eddy Gao                     Serpens - Map index                          ICS3U
+Building, saving and loading map indexes. See mapindex.h.
+
+The saved index is laid out like this, every number is a 32 bit little endian integer:
+    "SIDX"              magic
+    version             always 1
+    count               number of maps
+Then for every map:
+    name length, name
+    mtime (low 32 bits, then high 32 bits), size
+    width, height, spawnx, spawny, walls
+    thumbw, thumbh, then thumbw*thumbh bytes of thumbnail
+A file that isn't a map is saved with everything after its size 0 and no thumbnail.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "mapindex.h"
+#include "mapfile.h"
+
+void initindex(mapindex *ix) {
+    ix->maps = NULL;
+    ix->count = ix->capacity = ix->usable = 0;
+}
+
+void freeindex(mapindex *ix) {
+    for (int i=0; i<ix->count; i++) free(ix->maps[i].thumb);
+    free(ix->maps);
+    initindex(ix);
+}
+
+//adds an empty entry to the end of the index
+static mapinfo *addinfo(mapindex *ix) {
+    if (ix->count == ix->capacity) {
+        int capacity = ix->capacity ? ix->capacity * 2 : 64;
+        mapinfo *maps = (mapinfo*)realloc(ix->maps, sizeof(mapinfo) * capacity);
+        if (maps == NULL) return NULL;
+        ix->maps = maps;
+        ix->capacity = capacity;
+    }
+    mapinfo *m = &ix->maps[ix->count++];
+    memset(m, 0, sizeof(mapinfo));
+    return m;
+}
+
+static bool byname(const mapinfo &a, const mapinfo &b) {
+    return strcmp(a.name, b.name) < 0;
+}
+
+//the usable maps first, in name order
+static bool forpicker(const mapinfo &a, const mapinfo &b) {
+    if (a.invalid != b.invalid) return b.invalid;
+    return byname(a, b);
+}
+
+//puts the maps in the order the picker wants them and counts the usable ones
+static void sortindex(mapindex *ix) {
+    std::sort(ix->maps, ix->maps + ix->count, forpicker);
+    ix->usable = 0;
+    while (ix->usable < ix->count && !ix->maps[ix->usable].invalid) ix->usable++;
+}
+
+static void write32(FILE *f, int32_t n) {
+    unsigned char b[4] = {(unsigned char)n, (unsigned char)(n >> 8), (unsigned char)(n >> 16), (unsigned char)(n >> 24)};
+    fwrite(b, 1, 4, f);
+}
+
+static bool read32(FILE *f, int32_t *n) {
+    unsigned char b[4];
+    if (fread(b, 1, 4, f) != 4) return false;
+    *n = (int32_t)(b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24));
+    return true;
+}
+
+//loads a saved index, anything already in ix is thrown away
+bool loadindex(mapindex *ix, const char *path) {
+    freeindex(ix);
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+
+    char magic[4];
+    int32_t version, count;
+    bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, "SIDX", 4) == 0
+           && read32(f, &version) && version == 1 && read32(f, &count) && count >= 0;
+    for (int i=0; ok && i<count; i++) {
+        int32_t v[12];
+        mapinfo *m = addinfo(ix);
+        ok = m != NULL && read32(f, &v[0]) && v[0] >= 0 && v[0] <= maxMapName
+          && (int)fread(m->name, 1, v[0], f) == v[0];
+        for (int j=1; ok && j<12; j++) ok = read32(f, &v[j]);
+        if (!ok) break;
+        m->name[v[0]] = '\0';
+        m->mtime = (int64_t)(uint32_t)v[1] | ((int64_t)v[2] << 32);
+        m->size = v[3];
+        m->width = v[4];
+        m->height = v[5];
+        m->spawnx = v[6];
+        m->spawny = v[7];
+        m->walls = v[8];
+        m->thumbw = v[9];
+        m->thumbh = v[10];
+        if (m->thumbw == 0 && m->thumbh == 0) {
+            m->invalid = true;
+            ok = v[11] == 0;
+            continue;
+        }
+        ok = m->thumbw > 0 && m->thumbh > 0 && m->thumbw <= thumbSize && m->thumbh <= thumbSize && v[11] == 0;
+        if (!ok) break;
+        m->thumb = (unsigned char*)malloc(m->thumbw * m->thumbh);
+        ok = m->thumb != NULL && (int)fread(m->thumb, 1, m->thumbw * m->thumbh, f) == m->thumbw * m->thumbh;
+    }
+    fclose(f);
+    if (!ok) freeindex(ix);
+    sortindex(ix);
+    return ok;
+}
+
+bool saveindex(const mapindex *ix, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) return false;
+    fwrite("SIDX", 1, 4, f);
+    write32(f, 1);
+    write32(f, ix->count);
+    for (int i=0; i<ix->count; i++) {
+        const mapinfo *m = &ix->maps[i];
+        int length = strlen(m->name);
+        write32(f, length);
+        fwrite(m->name, 1, length, f);
+        write32(f, (int32_t)m->mtime);
+        write32(f, (int32_t)(m->mtime >> 32));
+        write32(f, m->size);
+        write32(f, m->width);
+        write32(f, m->height);
+        write32(f, m->spawnx);
+        write32(f, m->spawny);
+        write32(f, m->walls);
+        write32(f, m->thumbw);
+        write32(f, m->thumbh);
+        //reserved, so the thumbnail could be stored some other way later
+        write32(f, 0);
+        fwrite(m->thumb, 1, m->thumbw * m->thumbh, f);
+    }
+    return fclose(f) == 0;
+}
+
+//reads a map and works out everything the index keeps about it
+static bool describe(mapinfo *m, const char *path) {
+    mapdata d;
+    if (!readmap(&d, path)) return false;
+    m->width = d.width;
+    m->height = d.height;
+    m->spawnx = d.spawnx;
+    m->spawny = d.spawny;
+    m->walls = 0;
+    long squares = (long)d.width * d.height;
+    for (long i=0; i<squares; i++) m->walls += d.tiles[i] == MapWall;
+
+    //the thumbnail keeps the map's shape, each pixel is a wall if at least half of the squares under it are
+    int longest = d.width > d.height ? d.width : d.height;
+    m->thumbw = std::max(1L, (long)d.width * thumbSize / longest);
+    m->thumbh = std::max(1L, (long)d.height * thumbSize / longest);
+    free(m->thumb);
+    m->thumb = (unsigned char*)malloc(m->thumbw * m->thumbh);
+    if (m->thumb == NULL) {
+        freemap(&d);
+        return false;
+    }
+    for (int ty=0; ty<m->thumbh; ty++) {
+        int y0 = (long)ty * d.height / m->thumbh, y1 = std::max(y0 + 1, (int)((long)(ty + 1) * d.height / m->thumbh));
+        for (int tx=0; tx<m->thumbw; tx++) {
+            int x0 = (long)tx * d.width / m->thumbw, x1 = std::max(x0 + 1, (int)((long)(tx + 1) * d.width / m->thumbw));
+            long walls = 0, infertile = 0;
+            for (int y=y0; y<y1; y++) {
+                const unsigned char *row = d.tiles + (long)y*d.width;
+                for (int x=x0; x<x1; x++) {
+                    walls += row[x] == MapWall;
+                    infertile += row[x] == MapInfertile;
+                }
+            }
+            long area = (long)(y1 - y0) * (x1 - x0);
+            m->thumb[ty*m->thumbw + tx] = walls*2 >= area ? MapWall : infertile*2 >= area ? MapInfertile : MapEmpty;
+        }
+    }
+    if (d.spawnx != -1) m->thumb[((long)d.spawny * m->thumbh / d.height) * m->thumbw + (long)d.spawnx * m->thumbw / d.width] = MapSpawn;
+    freemap(&d);
+    return true;
+}
+
+//brings the index up to date with the maps in a directory: new and changed maps are read,
+//and maps that are gone are dropped. Returns how many maps had to be read, or -1 if nothing
+//changed at all (so there's no need to save the index again)
+int updateindex(mapindex *ix, const char *dir) {
+    DIR *d = opendir(dir);
+    if (d == NULL) return -1;
+
+    //the old entries are looked up by name, the new index is built up from scratch
+    std::sort(ix->maps, ix->maps + ix->count, byname);
+    mapindex fresh;
+    initindex(&fresh);
+    int parsed = 0;
+    bool changed = false;
+    char path[4096];
+    struct dirent *f;
+    while ((f = readdir(d)) != NULL) {
+        const char *ext = strrchr(f->d_name, '.');
+        if (ext == NULL || (strcmp(ext, ".txt") != 0 && strcmp(ext, ".smap") != 0)) continue;
+        if (strlen(f->d_name) > (size_t)maxMapName) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, f->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        mapinfo key;
+        strcpy(key.name, f->d_name);
+        mapinfo *old = std::lower_bound(ix->maps, ix->maps + ix->count, key, byname);
+        bool found = old != ix->maps + ix->count && strcmp(old->name, f->d_name) == 0;
+        mapinfo *m = addinfo(&fresh);
+        if (m == NULL) break;
+        if (found && old->mtime == (int64_t)st.st_mtime && old->size == (long)st.st_size) {
+            //unchanged, take its thumbnail rather than copying it
+            *m = *old;
+            old->thumb = NULL;
+            continue;
+        }
+        changed = true;
+        strcpy(m->name, f->d_name);
+        m->mtime = st.st_mtime;
+        m->size = st.st_size;
+        parsed++;
+        if (!describe(m, path)) {
+            //not a map, it's remembered as one that isn't so it's only read again once it changes
+            free(m->thumb);
+            memset(m, 0, sizeof(mapinfo));
+            strcpy(m->name, f->d_name);
+            m->mtime = st.st_mtime;
+            m->size = st.st_size;
+            m->invalid = true;
+        }
+    }
+    closedir(d);
+
+    if (fresh.count != ix->count) changed = true;
+    sortindex(&fresh);
+    freeindex(ix);
+    *ix = fresh;
+    return changed ? parsed : -1;
+}
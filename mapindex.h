@@ -0,0 +1,44 @@
+/* Eddy Gao                     Serpens - Map index                          ICS3U
+A list of every map in a directory, with the things the map picker shows about
+each one: its size, spawn point, how many walls it has and a small picture of it.
+The list is saved next to the maps, and a map is only read again when its file
+has changed since then, so even a directory with hundreds of maps is quick. Files
+that turn out not to be maps are kept in the list too, so they aren't read again
+either, but the picker never sees them.
+*/
+#ifndef MAPINDEX_H
+#define MAPINDEX_H
+
+#include <stdint.h>
+
+//longest map file name the index keeps, and the most pixels along a side of a thumbnail
+const int maxMapName = 255;
+const int thumbSize = 96;
+
+typedef struct mapinfo {
+    char name[maxMapName + 1];      //file name inside the directory
+    int64_t mtime;                  //when the file was last changed, and how big it was then
+    long size;
+    int width, height;
+    int spawnx, spawny;             //-1 if the map has no spawn point
+    long walls;
+    //the map shrunk (or grown) to fit in thumbSize by thumbSize, one MapTile per pixel
+    int thumbw, thumbh;
+    unsigned char *thumb;
+    //the file couldn't be read as a map, only its name, mtime and size mean anything
+    bool invalid;
+} mapinfo;
+
+typedef struct mapindex {
+    mapinfo *maps;      //the usable maps sorted by name, then the invalid files
+    int count, capacity;
+    int usable;         //how many of maps are real maps, the ones the picker shows
+} mapindex;
+
+void initindex(mapindex *ix);
+void freeindex(mapindex *ix);
+bool loadindex(mapindex *ix, const char *path);
+bool saveindex(const mapindex *ix, const char *path);
+int updateindex(mapindex *ix, const char *dir);
+
+#endif
@@ -1,5 +1,12 @@
 /* Eddy Gao                  Serpens - Mapmaker                            ICS3U
 This is a map editor that makes text files the main game, Serpens.cpp, can load.
+Saving to a name ending in .smap makes a smaller binary map instead.
+Every change can be undone and redone. Each stroke (a click or drag, a block or a
+fill) is kept as the runs of squares it changed in each row, with what they were
+before packed 4 to a byte, so the history stays small however big the map is.
+'a' shows what analyze.h finds out about the map in place of the info bar, checked
+again after every change: how much of it the snake can get to from the spawn point,
+food squares it can't, dead ends and the first problem with the map, if there is one.
 Maps can include four different types of tiles:
     Empty tiles
     Walls
@@ -11,6 +18,11 @@ Maps can include four different types of tiles:
 #include <string.h>
 #include <stdlib.h>
 #include <iostream>
+#include <vector>
+#include "mapfile.h"
+#include "analyze.h"
+#include "events.h"
+#include "trace.h"
 using namespace std;
 const int scrx = 480, scry = 640;
 
@@ -22,26 +34,66 @@ enum {
 	Infertile
 };
 
-//constants
-const int gridWidth = 24, gridHeight = 30;
+//constants, the view is the part of the screen the map is shown in
+const int viewWidth = scrx/20, viewHeight = 30;
 
 // global variables
 BITMAP *buffer; 
-int map[gridHeight][gridWidth];
-int colors[4];
+int *map, mapWidth, mapHeight;
+int spawnx = -1, spawny = -1;
+int camx = 0, camy = 0;
+int colors[4], voidcol;
 bool quit;
+//the analysis shown over the info bar, and whether the map's changed since it was done
+bool analyzing = false, mapChanged = true;
+mapreport report;
+
+//a run of squares in one row that a stroke set to the same tile. What they were before is
+//kept in the history's before list, starting at before
+typedef struct editrun {
+    int start, length;
+    long before;
+    unsigned char after;
+} editrun;
+
+//every stroke's runs one after another, and where each stroke's runs start. Strokes from
+//current on have been undone, and are thrown away when something new is drawn
+typedef struct history {
+    vector<editrun> runs;
+    vector<unsigned char> before;
+    vector<long> strokes;
+    int current;
+    bool open;      //a stroke is being drawn, its runs are at the end
+} history;
+history edits;
 
 //prototype
+int &at(int x, int y);
+bool newmap(int width, int height);
 void redraw(int x, int y);
+void redrawall();
+void scrollto(int x, int y);
 void tofile();
 void close();
 void openfile();
+void resize();
+void beginstroke();
+void endstroke();
+void clearhistory();
+void paintrun(int x, int y, int length, int tile);
+void paint(int x, int y, int tile);
+void block(int x1, int y1, int x2, int y2, int tile);
+void fill(int x, int y, int tile);
+bool undo();
+bool redo();
+void redrawrun(int x, int y, int length);
+void analyze();
 
 int main() {
     //declare and initialize
     int brush=0;
-    int x=0, y=0, spawnx=-1, spawny=-1, drawx, drawy, mdx, mdy, oldz=0, newz;
-    bool draw=false;
+    int x=0, y=0, drawx, drawy, mdx, mdy, oldz=0, newz;
+    bool draw=false, stroking=false;
     quit=false;
     BITMAP *selection, *infobar;
     
@@ -49,6 +101,7 @@ int main() {
     allegro_init();
 	install_keyboard();
 	install_mouse();
+	installevents();
     
 	set_color_depth(desktop_color_depth());
 	set_gfx_mode(GFX_AUTODETECT_WINDOWED, scrx, scry, 0, 0);
@@ -59,13 +112,15 @@ int main() {
     colors[1] = makecol(10, 10, 10);
     colors[2] = makecol(50, 20, 230);
     colors[3] = makecol(200, 60, 20);
+    voidcol = makecol(60, 60, 60);
 
 	buffer = create_bitmap(scrx, scry);
 	selection = create_bitmap(20,20);
 	infobar = load_bitmap("bar.bmp", 0);
 	
 	clear_to_color(selection, makecol(200, 20, 10));
-	clear_to_color(buffer, colors[0]);
+	newmap(24, 30);
+	redrawall();
 	
 	blit(infobar, buffer, 0, 0, 0, 600, infobar->w, infobar->h);
 
@@ -73,19 +128,19 @@ int main() {
         get_mouse_mickeys(&mdx, &mdy);
         if ((mdx!=0 || mdy!=0) && (mouse_x > 0 && mouse_y > 0 && mouse_x < 480 && mouse_y < 640)) {
             redraw(x, y);
-            x = mouse_x/20;
-            y = (mouse_y < 600) ? (mouse_y/20) : (29);
+            x = camx + mouse_x/20;
+            y = camy + ((mouse_y < 600) ? (mouse_y/20) : (viewHeight-1));
+            if (x >= mapWidth) x = mapWidth-1;
+            if (y >= mapHeight) y = mapHeight-1;
         }
+        //a drag is one stroke, from the button going down to it coming back up
         if (mouse_b & 1) {
-            if (brush == 2) {
-                if (spawnx != -1 && map[spawny][spawnx]==2) {
-                    map[spawny][spawnx] = 0;
-                    redraw(spawnx, spawny);
-                }
-                spawnx = x;
-                spawny = y;
-            }
-            map[y][x] = brush;
+            if (!stroking) beginstroke();
+            stroking = true;
+            paint(x, y, brush);
+        } else if (stroking) {
+            endstroke();
+            stroking = false;
         }
         if (mouse_b & 2) {
             if (brush==2) {
@@ -100,18 +155,19 @@ int main() {
                 }
                 else 
                     //draw everything from initial coordinates all the way to current coordinates
-                    for (int i = drawy; drawy<y ? i<=y: i>=y; drawy<y ? i++ : i--) {
-                        for (int j = drawx; drawx<x ? j<=x: j>=x; drawx<x ? j++ : j--) {
-                                map[i][j] = brush;
-                                redraw(j, i);
-                        }
-                    }
+                    block(drawx, drawy, x, y, brush);
                 //toggle drawing
                 draw=!draw;
                 drawx = x;
                 drawy = y;
             }
         }
+        if ((mouse_b & 4) && !stroking) {
+            if (brush == 2) allegro_message("You can't fill with spawn points!");
+            else fill(x, y, brush);
+            //one fill per click
+            while (mouse_b & 4) waitevent(100);
+        }
         if (mouse_z!=oldz) {
             newz = mouse_z;
             brush+=(newz-oldz);
@@ -126,7 +182,7 @@ int main() {
                 //navigation
     			case KEY_DOWN:
                     redraw(x, y);
-                    if (y+1<gridHeight) y++;
+                    if (y+1<mapHeight) y++;
     				break;
     			case KEY_UP:
                     redraw(x, y);
@@ -134,7 +190,7 @@ int main() {
     				break;
     			case KEY_RIGHT:
                     redraw(x, y);
-                    if (x+1<gridWidth) x++;
+                    if (x+1<mapWidth) x++;
     				break;
     			case KEY_LEFT:
                     redraw(x, y);
@@ -148,15 +204,9 @@ int main() {
                     break;
                 //draw
                 case KEY_SPACE:
-                    if (brush == 2) {
-                        if (spawnx != -1 && map[spawny][spawnx]==2) {
-                            map[spawny][spawnx] = 0;
-                            redraw(spawnx, spawny);
-                        }
-                        spawnx = x;
-                        spawny = y;
-                    }
-                    map[y][x] = brush;
+                    beginstroke();
+                    paint(x, y, brush);
+                    endstroke();
                     break;
                 //draw large blocks
                 case KEY_X:
@@ -172,28 +222,59 @@ int main() {
                     }
                     else 
                         //draw everything from initial coordinates all the way to current coordinates
-                        for (int i = drawy; drawy<y ? i<=y: i>=y; drawy<y ? i++ : i--) {
-                            for (int j = drawx; drawx<x ? j<=x: j>=x; drawx<x ? j++ : j--) {
-                                    map[i][j] = brush;
-                                    redraw(j, i);
-                            }
-                        }
+                        block(drawx, drawy, x, y, brush);
                     //toggle drawing
                     draw=!draw;
                     break;
+                //fill the area around the selection that's the same as it
+                case KEY_F:
+                    if (brush == 2) allegro_message("You can't fill with spawn points!");
+                    else fill(x, y, brush);
+                    break;
+                case KEY_U:
+                    undo();
+                    break;
+                case KEY_R:
+                    redo();
+                    break;
                 case KEY_S:
                     tofile();
                     clear_keybuf();
                     break;
                 case KEY_D:
                     openfile();
+                    //the new map might be smaller
+                    if (x >= mapWidth) x = mapWidth-1;
+                    if (y >= mapHeight) y = mapHeight-1;
+                    draw = false;
                     clear_keybuf();
                     break;
+                case KEY_N:
+                    resize();
+                    x = y = 0;
+                    spawnx = spawny = -1;
+                    draw = false;
+                    clear_keybuf();
+                    break;
+                case KEY_A:
+                    analyzing = !analyzing;
+                    mapChanged = true;
+                    if (!analyzing) blit(infobar, buffer, 0, 0, 0, 600, infobar->w, infobar->h);
+                    break;
+                case KEY_T:
+                    if (!tracedump("mapmaker.trace.json")) printf("Could not save the trace, is tracing built in?\n");
+                    break;
                 case KEY_H:
-                     allegro_message("'z' to change brushes.\nSpace to draw.\n'x' to draw a block.\n's' to save, and 'd' to load a file.");
+                     allegro_message("'z' to change brushes.\nSpace to draw.\n'x' to draw a block.\n'f' to fill, or the middle mouse button.\n'u' to undo, and 'r' to redo.\n's' to save, and 'd' to load a file.\n'n' to start a new map of any size.\n'a' to check the map for problems as you go.");
         	}
         }
         
+        //keep the selection in view, scrolling over maps that don't fit on the screen
+        scrollto(x, y);
+
+        //check the map again whenever it changes, while the analysis is showing
+        if (analyzing && mapChanged) analyze();
+
         //change selection outline colour to reflect the value of draw
         clear_to_color(selection, !draw ? makecol(20, 10, 200) : makecol(200, 20, 10));
         
@@ -202,106 +283,298 @@ int main() {
         
         //draw initial coordinate location
         if (draw) {
-            draw_sprite(buffer, selection, drawx*20, drawy*20);
+            draw_sprite(buffer, selection, (drawx-camx)*20, (drawy-camy)*20);
         }
         
         //change selection outline color once more
         clear_to_color(selection, draw ? makecol(20, 10, 200) : makecol(200, 20, 10));
         rectfill(selection, 2, 2, 17, 17, colors[brush]);
         
-        draw_sprite(buffer, selection, x*20, y*20);
+        draw_sprite(buffer, selection, (x-camx)*20, (y-camy)*20);
         
 
 		blit(buffer, screen, 0, 0, 0, 0, buffer->w, buffer->h);
 
-		//rest(10);
+		//nothing changes until there's input, so sleep until then
+		waitevent(100);
 	}
 
+	removeevents();
 	return 0;
 }
 END_OF_MAIN()
 
 
+//gets a square of the map
+int &at(int x, int y) {
+    return map[y*mapWidth + x];
+}
+
+//replaces the map with an empty one of the given size
+bool newmap(int width, int height) {
+    int *cells = (int*)calloc(width * height, sizeof(int));
+    if (cells == NULL) return false;
+    free(map);
+    map = cells;
+    mapWidth = width;
+    mapHeight = height;
+    camx = camy = 0;
+    spawnx = spawny = -1;
+    mapChanged = true;
+    //the history is for the old map
+    clearhistory();
+    return true;
+}
+
+//redraws a square of the map, if it's in view
 void redraw(int x, int y) {
-    rectfill(buffer, x*20,y*20, x*20 + 19, y*20 + 19, colors[map[y][x]]);
+    TRACE("redraw");
+    x -= camx;
+    y -= camy;
+    if (x < 0 || y < 0 || x >= viewWidth || y >= viewHeight) return;
+    rectfill(buffer, x*20,y*20, x*20 + 19, y*20 + 19, colors[at(x + camx, y + camy)]);
+}
+
+//redraws part of a row of the map, one rectfill for each stretch of the same tile that's in view
+void redrawrun(int x, int y, int length) {
+    if (y < camy || y >= camy + viewHeight) return;
+    int begin = x > camx ? x : camx, end = x + length < camx + viewWidth ? x + length : camx + viewWidth;
+    while (begin < end) {
+        int tile = at(begin, y), stop = begin + 1;
+        while (stop < end && at(stop, y) == tile) stop++;
+        rectfill(buffer, (begin - camx)*20, (y - camy)*20, (stop - camx)*20 - 1, (y - camy)*20 + 19, colors[tile]);
+        begin = stop;
+    }
+}
+
+//redraws the whole view, anything past the edge of the map is shown in grey
+void redrawall() {
+    for (int i=0; i<viewHeight; i++) {
+        for (int j=0; j<viewWidth; j++) {
+            if (camx + j < mapWidth && camy + i < mapHeight) redraw(camx + j, camy + i);
+            else rectfill(buffer, j*20, i*20, j*20 + 19, i*20 + 19, voidcol);
+        }
+    }
+}
+
+//moves the view just enough to show the given square
+void scrollto(int x, int y) {
+    int oldx = camx, oldy = camy;
+    if (x < camx) camx = x;
+    if (x >= camx + viewWidth) camx = x - viewWidth + 1;
+    if (y < camy) camy = y;
+    if (y >= camy + viewHeight) camy = y - viewHeight + 1;
+    if (camx != oldx || camy != oldy) redrawall();
+}
+
+//starts recording a stroke, anything that was undone can't be redone after this
+void beginstroke() {
+    if (edits.open) return;
+    if (edits.current < (int)edits.strokes.size()) {
+        long first = edits.strokes[edits.current];
+        if (first < (long)edits.runs.size()) edits.before.resize(edits.runs[first].before);
+        edits.runs.resize(first);
+        edits.strokes.resize(edits.current);
+    }
+    edits.strokes.push_back(edits.runs.size());
+    edits.open = true;
+}
+
+//finishes the stroke being recorded, one that didn't change anything isn't kept
+void endstroke() {
+    if (!edits.open) return;
+    edits.open = false;
+    if (edits.strokes.back() == (long)edits.runs.size()) edits.strokes.pop_back();
+    else edits.current = edits.strokes.size();
+}
+
+void clearhistory() {
+    edits.runs.clear();
+    edits.before.clear();
+    edits.strokes.clear();
+    edits.current = 0;
+    edits.open = false;
+}
+
+//keeps the spawn point up to date as a square changes from old to tile
+static void trackspawn(int x, int y, int old, int tile) {
+    if (tile == Spawn) {
+        spawnx = x;
+        spawny = y;
+    } else if (old == Spawn && spawnx == x && spawny == y) spawnx = spawny = -1;
+}
+
+//sets length squares of a row to tile, recording them in the open stroke, and redraws them.
+//Setting a spawn point takes away the old one
+void paintrun(int x, int y, int length, int tile) {
+    int start = y*mapWidth + x, changed = 0;
+    for (int i=0; i<length; i++) changed += map[start + i] != tile;
+    if (changed == 0) return;
+    bool recording = edits.open;
+    if (!recording) beginstroke();
+    if (tile == Spawn && spawnx != -1 && at(spawnx, spawny) == Spawn) paint(spawnx, spawny, Empty);
+    editrun r = {start, length, (long)edits.before.size(), (unsigned char)tile};
+    edits.runs.push_back(r);
+    edits.before.resize(r.before + (length + 3) / 4, 0);
+    for (int i=0; i<length; i++) {
+        edits.before[r.before + i/4] |= map[start + i] << (i % 4 * 2);
+        trackspawn(x + i, y, map[start + i], tile);
+        map[start + i] = tile;
+    }
+    mapChanged = true;
+    if (!recording) endstroke();
+    redrawrun(x, y, length);
 }
 
+void paint(int x, int y, int tile) {
+    paintrun(x, y, 1, tile);
+}
+
+//fills the block between two corners, a row at a time
+void block(int x1, int y1, int x2, int y2, int tile) {
+    if (x1 > x2) swap(x1, x2);
+    if (y1 > y2) swap(y1, y2);
+    beginstroke();
+    for (int i=y1; i<=y2; i++) paintrun(x1, i, x2 - x1 + 1, tile);
+    endstroke();
+}
+
+//flood fills the area of the same tile around (x, y), without going round the edges. Each
+//stretch of a row is filled in one go, and starts off a search of the rows above and below it
+//that only leaves one square to carry on from for every stretch it finds there
+void fill(int x, int y, int tile) {
+    TRACE("fill");
+    int target = at(x, y);
+    if (target == tile) return;
+    vector<int> seeds;
+    seeds.push_back(y*mapWidth + x);
+    beginstroke();
+    while (!seeds.empty()) {
+        int c = seeds.back();
+        seeds.pop_back();
+        int sy = c / mapWidth, left = c % mapWidth, right = left;
+        if (map[c] != target) continue;
+        while (left > 0 && at(left - 1, sy) == target) left--;
+        while (right < mapWidth - 1 && at(right + 1, sy) == target) right++;
+        paintrun(left, sy, right - left + 1, tile);
+        for (int ny = sy - 1; ny <= sy + 1; ny += 2) {
+            if (ny < 0 || ny >= mapHeight) continue;
+            for (int i=left; i<=right; i++) {
+                if (at(i, ny) == target && (i == left || at(i - 1, ny) != target)) seeds.push_back(ny*mapWidth + i);
+            }
+        }
+    }
+    endstroke();
+}
+
+//puts a run back the way it was, or the way the stroke left it
+static void applyrun(editrun *r, bool forward) {
+    int x = r->start % mapWidth, y = r->start / mapWidth;
+    for (int i=0; i<r->length; i++) {
+        int old = map[r->start + i];
+        int tile = forward ? r->after : (edits.before[r->before + i/4] >> (i % 4 * 2)) & 3;
+        trackspawn(x + i, y, old, tile);
+        map[r->start + i] = tile;
+    }
+    mapChanged = true;
+    redrawrun(x, y, r->length);
+}
+
+//undoes the last stroke, false if there's nothing to undo
+bool undo() {
+    TRACE("undo");
+    endstroke();
+    if (edits.current == 0) return false;
+    edits.current--;
+    long first = edits.strokes[edits.current];
+    long last = edits.current + 1 < (int)edits.strokes.size() ? edits.strokes[edits.current + 1] : edits.runs.size();
+    //the runs go back in the opposite order, in case a stroke went over the same square twice
+    for (long i=last - 1; i>=first; i--) applyrun(&edits.runs[i], false);
+    return true;
+}
+
+//does the last undone stroke again, false if there's nothing to redo
+bool redo() {
+    TRACE("redo");
+    endstroke();
+    if (edits.current == (int)edits.strokes.size()) return false;
+    long first = edits.strokes[edits.current];
+    long last = edits.current + 1 < (int)edits.strokes.size() ? edits.strokes[edits.current + 1] : edits.runs.size();
+    for (long i=first; i<last; i++) applyrun(&edits.runs[i], true);
+    edits.current++;
+    return true;
+}
+
+//checks the map with analyzemap and shows what it found where the info bar is
+void analyze() {
+    TRACE("analyze");
+    static vector<unsigned char> tiles;
+    char problems[1][128];
+    tiles.assign(map, map + (long)mapWidth*mapHeight);
+    analyzemap(&report, &tiles[0], mapWidth, mapHeight, spawnx, spawny);
+    int n = mapproblems(&report, problems, 1);
+    mapChanged = false;
+
+    int text = makecol(230, 230, 230);
+    rectfill(buffer, 0, 600, scrx - 1, scry - 1, makecol(30, 30, 30));
+    textprintf_ex(buffer, font, 4, 602, text, -1, "%ld of %ld open squares reachable, %d way%s out", report.reachable, report.open, report.spawnDegree, report.spawnDegree == 1 ? "" : "s");
+    textprintf_ex(buffer, font, 4, 612, text, -1, "%ld unreachable food squares, %ld in dead ends", report.unreachableFertile, report.deadEnds);
+    textprintf_ex(buffer, font, 4, 622, text, -1, "biggest loop safe area %ld, %d open area%s", report.loopSafe, report.regions, report.regions == 1 ? "" : "s");
+    if (n > 0) textprintf_ex(buffer, font, 4, 632, makecol(230, 80, 60), -1, "%.59s", problems[0]);
+}
+
+//asks for the size of a new, empty map
+void resize() {
+    int width, height;
+    printf("Enter the width and height of the new map: ");
+    if (scanf("%d %d", &width, &height) != 2 || width < 1 || height < 1 || !newmap(width, height)) {
+        printf("Could not make a map that size.\n");
+        return;
+    }
+    redrawall();
+}
+
+//saves the map, as a binary map if the name ends in .smap
 void tofile() {
-    char name[20];
-    char tmp[20];
+    TRACE("tofile");
+    char name[PATH_MAX];
+    char tmp[PATH_MAX - 8];
+    mapdata m;
     printf("Enter a name for this file: ");
-    fflush(stdin);
-    gets(tmp);
+    if (scanf("%s", tmp) != 1) return;
     sprintf(name, "maps/%s", tmp);
-    FILE *fptr = fopen(name, "w");
-    if (!fptr) { 
-        allegro_message("oh shit"); 
-        exit(1);
+
+    if (!allocmap(&m, mapWidth, mapHeight)) {
+        allegro_message("Not enough memory to save the map.");
+        return;
     }
-    
-    for (int i=0; i<gridHeight; i++) {
-        for (int j=0; j<gridWidth; j++) {
-            switch(map[i][j]) {
-                case 0:
-                    fprintf(fptr, ".");
-                    break;
-                case 1:
-                    fprintf(fptr, "#");
-                    break;
-                case 2:
-                    fprintf(fptr, "s");
-                    break;
-                case 3:
-                    fprintf(fptr, "x");
-                    break;
+    for (int i=0; i<mapHeight; i++) {
+        for (int j=0; j<mapWidth; j++) {
+            m.tiles[i*mapWidth + j] = at(j, i);
+            if (at(j, i) == Spawn) {
+                m.spawnx = j;
+                m.spawny = i;
             }
         }
-        fprintf(fptr, "\n");
     }
-    fclose(fptr);
+    if (!writemap(&m, name)) allegro_message("Could not save to %s", name);
+    freemap(&m);
 }
 
+//loads a map in either of the formats in mapfile.h
 bool loadMap(char* input) {
-    char tile;
-    FILE* inputfile = fopen(input, "r");
-    
-    //make sure that we get a valid file
-    if (inputfile==NULL) {
+    TRACE("loadMap");
+    mapdata m;
+    if (!readmap(&m, input)) return false;
+    if (!newmap(m.width, m.height)) {
+        freemap(&m);
         return false;
     }
-    
-    //read in map data
-    for (int y=0; y<30; y++) {
-        for (int x=0; x<24; x++) {
-            if (fscanf(inputfile, "%c", &tile) != 1) {
-                fclose(inputfile);
-                return false;
-            }
-            switch (tile) {
-                case '\r':
-                case '\n':
-                    x--;
-                    continue;
-                case 's':
-                    map[y][x] = Spawn;
-                    break;
-                case '.':
-                    map[y][x] = Empty;
-                    break;
-                case '#':
-                    map[y][x] = Wall;
-                    break;
-                case 'x':
-                    map[y][x] = Infertile;
-                    break;
-                default:
-                    map[y][x] = Empty;
-            }
-            redraw(x, y);
-        }
-    }
-
-    fclose(inputfile);
+    for (long i=0; i<(long)m.width*m.height; i++) map[i] = m.tiles[i];
+    spawnx = m.spawnx;
+    spawny = m.spawny;
+    freemap(&m);
+    redrawall();
     return true;
 }
 
@@ -322,4 +595,5 @@ void openfile() {
 //this is called when the close button is clicked
 void close() {
     quit=true;
+    wakeevents();
 }
@@ -0,0 +1,246 @@
+/* Eddy Gao                     Serpens - Pathfinding                        ICS3U
+The autopilot's search. See path.h.
+
+The search starts at the food and spreads out one step at a time, so the first of
+the head's neighbours it reaches is the start of a shortest path to the food. Only
+the rows the frontier is on (and the ones next to them) are worked on each step,
+so searches that end quickly stay cheap on big maps.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "path.h"
+
+void pinit(pathfinder *p) {
+    p->width = p->height = p->words = 0;
+    p->avail = p->frontier = p->next = NULL;
+    p->distance = -1;
+}
+
+void pdestroy(pathfinder *p) {
+    free(p->avail);
+    free(p->frontier);
+    free(p->next);
+    pinit(p);
+}
+
+//makes room for searching a map of the given size
+bool psetsize(pathfinder *p, int width, int height) {
+    if (width == p->width && height == p->height) return true;
+    pdestroy(p);
+    //an even number of words between the guards, so rows can be done two words at a time
+    int words = (((width + 63) / 64 + 1) & ~1) + 2;
+    long size = sizeof(uint64_t) * words * height;
+    p->avail = (uint64_t*)malloc(size);
+    p->frontier = (uint64_t*)malloc(size);
+    p->next = (uint64_t*)malloc(size);
+    if (!p->avail || !p->frontier || !p->next) {
+        pdestroy(p);
+        return false;
+    }
+    p->width = width;
+    p->height = height;
+    p->words = words;
+    return true;
+}
+
+//turns 16 packed grid squares into a bit for each one that is a snake (or a wall)
+static inline uint64_t snakebits(uint64_t w) {
+    //a Snake square is 0001, so flip that bit and look for squares that are all zero
+    uint64_t x = w ^ 0x1111111111111111ULL;
+    x = ~(x | (x >> 1) | (x >> 2) | (x >> 3)) & 0x1111111111111111ULL;
+    //squeeze the bit from every square together
+    x = (x | (x >> 3)) & 0x0303030303030303ULL;
+    x = (x | (x >> 6)) & 0x000f000f000f000fULL;
+    x = (x | (x >> 12)) & 0x000000ff000000ffULL;
+    return (x | (x >> 24)) & 0xffff;
+}
+
+static inline uint64_t *row(uint64_t *board, pathfinder *p, int y) {
+    return board + (long)y*p->words + 1;
+}
+
+static inline bool getbit(uint64_t *r, int x) {
+    return (r[x >> 6] >> (x & 63)) & 1;
+}
+
+//marks every square the snake could move onto in avail
+static void buildavail(pathfinder *p, engine *e) {
+    int n = p->words - 2;
+    int full = p->width / 64;
+    uint64_t lastmask = (p->width & 63) ? ((uint64_t)1 << (p->width & 63)) - 1 : 0;
+    for (int y=0; y<p->height; y++) {
+        uint64_t *out = row(p->avail, p, y);
+        const uint64_t *in = e->grid + (long)y*e->stride;
+        out[-1] = out[n] = 0;
+        for (int i=0; i<n; i++) {
+            uint64_t bits = 0;
+            for (int j=0; j<4; j++) {
+                int w = i*4 + j;
+                if (w < e->stride) bits |= snakebits(in[w]) << (j*16);
+            }
+            //squares past the edge of the map are never available
+            uint64_t mask = i < full ? ~(uint64_t)0 : i == full ? lastmask : 0;
+            out[i] = ~bits & mask;
+        }
+    }
+    //the tail moves out of the way before the head moves, unless the snake is growing
+    if (e->extend == 0 && e->body.length > 1) {
+        segment *tail = getElem(&e->body, 0);
+        row(p->avail, p, tail->y)[tail->x >> 6] |= (uint64_t)1 << (tail->x & 63);
+    }
+}
+
+//spreads one row of the frontier out by a step onto the available squares, and takes the
+//squares it reached out of avail. Returns whether it reached anything
+static bool expandrow(pathfinder *p, const uint64_t *f, const uint64_t *above, const uint64_t *below, uint64_t *avail, uint64_t *out) {
+    int n = p->words - 2, i = 0;
+    uint64_t any = 0;
+#ifdef __SSE2__
+    //two words at a time, each square gets its left and right neighbours from the words beside it
+    __m128i acc = _mm_setzero_si128();
+    for (; i < n; i += 2) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(f + i));
+        __m128i l = _mm_loadu_si128((const __m128i*)(f + i - 1));
+        __m128i r = _mm_loadu_si128((const __m128i*)(f + i + 1));
+        __m128i v = _mm_or_si128(_mm_or_si128(_mm_slli_epi64(c, 1), _mm_srli_epi64(l, 63)),
+                                 _mm_or_si128(_mm_srli_epi64(c, 1), _mm_slli_epi64(r, 63)));
+        v = _mm_or_si128(v, _mm_or_si128(_mm_loadu_si128((const __m128i*)(above + i)), _mm_loadu_si128((const __m128i*)(below + i))));
+        __m128i a = _mm_loadu_si128((const __m128i*)(avail + i));
+        v = _mm_and_si128(v, a);
+        _mm_storeu_si128((__m128i*)(out + i), v);
+        _mm_storeu_si128((__m128i*)(avail + i), _mm_andnot_si128(v, a));
+        acc = _mm_or_si128(acc, v);
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    any = lanes[0] | lanes[1];
+#endif
+    for (; i < n; i++) {
+        uint64_t v = (f[i] << 1) | (f[i-1] >> 63) | (f[i] >> 1) | (f[i+1] << 63) | above[i] | below[i];
+        v &= avail[i];
+        out[i] = v;
+        avail[i] &= ~v;
+        any |= v;
+    }
+
+    //wrap around the left and right edges
+    int last = p->width - 1;
+    if (getbit((uint64_t*)f, last) && getbit(avail, 0)) {
+        out[0] |= 1;
+        avail[0] &= ~(uint64_t)1;
+        any = 1;
+    }
+    if (getbit((uint64_t*)f, 0) && getbit(avail, last)) {
+        out[last >> 6] |= (uint64_t)1 << (last & 63);
+        avail[last >> 6] &= ~((uint64_t)1 << (last & 63));
+        any = 1;
+    }
+    return any != 0;
+}
+
+//works out which way the snake should go to get to the food the fastest. If the food
+//can't be reached it just goes anywhere it won't die right away
+int steer(pathfinder *p, engine *e) {
+    int dirs[4], nx[4], ny[4], n = 0;
+    int order[5] = {None, Up, Down, Left, Right};
+    p->distance = -1;
+    if (!psetsize(p, e->width, e->height)) return None;
+    buildavail(p, e);
+
+    //the squares the head can move to, going straight ahead is tried first so the snake turns less
+    order[0] = e->velx > 0 ? Right : e->velx < 0 ? Left : e->vely > 0 ? Down : e->vely < 0 ? Up : None;
+    for (int i=0; i<5; i++) {
+        int d = order[i];
+        if (d == None || (i > 0 && d == order[0])) continue;
+        if (i > 0 && order[0] != None && !canturn(e, d)) continue;
+        int x = e->posx + (d == Right) - (d == Left);
+        int y = e->posy + (d == Down) - (d == Up);
+        x = (x + e->width) % e->width;
+        y = (y + e->height) % e->height;
+        if (!getbit(row(p->avail, p, y), x)) continue;
+        dirs[n] = d;
+        nx[n] = x;
+        ny[n] = y;
+        n++;
+    }
+    if (n == 0) return None;
+    if (e->foodx == -1) return dirs[0];
+
+    for (int i=0; i<n; i++) {
+        if (nx[i] == e->foodx && ny[i] == e->foody) {
+            p->distance = 1;
+            return dirs[i];
+        }
+    }
+
+    long size = sizeof(uint64_t) * p->words * p->height;
+    memset(p->frontier, 0, size);
+    memset(p->next, 0, size);
+    row(p->frontier, p, e->foody)[e->foodx >> 6] |= (uint64_t)1 << (e->foodx & 63);
+    row(p->avail, p, e->foody)[e->foodx >> 6] &= ~((uint64_t)1 << (e->foodx & 63));
+
+    //rows lo to hi (which can go past the edges, they wrap) hold the whole frontier
+    int lo = e->foody, hi = e->foody;
+    for (int steps = 2; ; steps++) {
+        int newlo = INT_MAX, newhi = INT_MIN;
+        int first = lo - 1, count = hi - lo + 3;
+        if (count > p->height) count = p->height;
+        for (int k = first; k < first + count; k++) {
+            int y = ((k % p->height) + p->height) % p->height;
+            int up = y == 0 ? p->height - 1 : y - 1;
+            int down = y == p->height - 1 ? 0 : y + 1;
+            if (expandrow(p, row(p->frontier, p, y), row(p->frontier, p, up), row(p->frontier, p, down),
+                          row(p->avail, p, y), row(p->next, p, y))) {
+                if (k < newlo) newlo = k;
+                newhi = k;
+            }
+        }
+        //nowhere left to go, the food can't be reached
+        if (newlo == INT_MAX) break;
+
+        //next is empty again once the old frontier is cleared out and they're swapped
+        for (int k = lo; k <= hi && k < lo + p->height; k++) {
+            int y = ((k % p->height) + p->height) % p->height;
+            memset(row(p->frontier, p, y), 0, sizeof(uint64_t) * (p->words - 2));
+        }
+        uint64_t *t = p->frontier;
+        p->frontier = p->next;
+        p->next = t;
+        lo = newlo;
+        hi = newhi;
+
+        for (int i=0; i<n; i++) {
+            if (getbit(row(p->frontier, p, ny[i]), nx[i])) {
+                p->distance = steps;
+                return dirs[i];
+            }
+        }
+    }
+    return dirs[0];
+}
+
+//a simple bot that heads for the food and only avoids running into itself right away
+int greedy(engine *e) {
+    int order[6];
+    int n = 0;
+    if (e->foodx < e->posx) order[n++] = Left;
+    if (e->foodx > e->posx) order[n++] = Right;
+    if (e->foody < e->posy) order[n++] = Up;
+    if (e->foody > e->posy) order[n++] = Down;
+    order[n++] = Up;
+    order[n++] = Left;
+    for (int i=0; i<n; i++) {
+        int x = e->posx, y = e->posy;
+        if (!canturn(e, order[i])) continue;
+        x += (order[i] == Right) - (order[i] == Left);
+        y += (order[i] == Down) - (order[i] == Up);
+        x = (x + e->width) % e->width;
+        y = (y + e->height) % e->height;
+        if (getgrid(e, x, y) != Snake) return order[i];
+    }
+    return None;
+}
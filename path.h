@@ -0,0 +1,31 @@
+/* Eddy Gao                     Serpens - Pathfinding                        ICS3U
+The autopilot. It finds the shortest way from the snake's head to the food with a
+breadth first search over bitboards: every row of the map is packed into 64 bit
+words with a bit per square, so a whole step of the search is a few shifts and ORs
+per word instead of a queue of squares. The search wraps around the edges of the
+map the same way the snake does.
+There is also a much simpler greedy bot, for comparing against.
+*/
+#ifndef PATH_H
+#define PATH_H
+
+#include <stdint.h>
+#include "engine.h"
+
+typedef struct pathfinder {
+    //size of the map, and the number of words in each bitboard row. Every row has
+    //an empty guard word before and after it so the shifts never need bounds checks
+    int width, height, words;
+    //squares the search can still go to, the squares it reached last step, and the next step
+    uint64_t *avail, *frontier, *next;
+    //how many steps the last search took to reach the head, -1 if it couldn't
+    int distance;
+} pathfinder;
+
+void pinit(pathfinder *p);
+void pdestroy(pathfinder *p);
+bool psetsize(pathfinder *p, int width, int height);
+int steer(pathfinder *p, engine *e);
+int greedy(engine *e);
+
+#endif
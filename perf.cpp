@@ -0,0 +1,184 @@
+/* Eddy Gao                     Serpens - Performance counters               ICS3U
+Frame timing for the overlay. See perf.h.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include "perf.h"
+
+//the histogram has this many buckets for every doubling of the frame time, the first
+//is everything under a microsecond and the last goes up to about 14 seconds
+const int bucketsPerOctave = 4, numBuckets = 96;
+
+typedef struct framesample {
+    double when;                //when the frame finished, in seconds since the program started
+    float phase[numPhases];     //milliseconds spent on each phase
+    int ticks;                  //ticks run since the frame before
+    int bucket;                 //where the frame is counted in the histogram
+} framesample;
+
+//the last perfFrames frames, frame n goes in ring[n % perfFrames]. written only goes up,
+//and is only stored once a frame is all there, so a reader can tell what it may have missed
+static framesample ring[perfFrames];
+static std::atomic<unsigned> written(0);
+static std::atomic<int> histogram[numBuckets];
+
+//the frame being timed, only the game loop touches these
+static std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now(), mark;
+static double current[numPhases];
+static int currentTicks = 0;
+
+//what perfnote() has been told, name has to be a string that's always there, like a literal
+typedef struct perfentry {
+    const char *name;
+    double value;
+} perfentry;
+static perfentry notes[perfNotes];
+static int numNotes = 0;
+
+static int bucketof(double ms) {
+    double us = ms * 1000;
+    if (us < 1) return 0;
+    int b = 1 + (int)(log2(us) * bucketsPerOctave);
+    return b < numBuckets ? b : numBuckets - 1;
+}
+
+//the longest frame time that goes in a bucket, in milliseconds
+static double bucketlimit(int b) {
+    return pow(2.0, (double)b / bucketsPerOctave) / 1000;
+}
+
+static double seconds() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    return elapsed.count();
+}
+
+//starts timing, call it before the first phase of anything
+void perfbegin() {
+    mark = std::chrono::steady_clock::now();
+}
+
+//adds the time since the last mark to a phase of the current frame
+void perfmark(int phase) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = now - mark;
+    current[phase] += elapsed.count();
+    mark = now;
+}
+
+void perftick() {
+    currentTicks++;
+}
+
+//finishes the current frame and puts it in the ring, in place of the oldest one
+void perfframe() {
+    unsigned n = written.load(std::memory_order_relaxed);
+    framesample *f = &ring[n % perfFrames];
+    if (n >= (unsigned)perfFrames) histogram[f->bucket].fetch_sub(1, std::memory_order_relaxed);
+
+    double total = 0;
+    for (int i=0; i<numPhases; i++) {
+        f->phase[i] = current[i];
+        total += current[i];
+        current[i] = 0;
+    }
+    f->when = seconds();
+    f->ticks = currentTicks;
+    f->bucket = bucketof(total);
+    currentTicks = 0;
+
+    histogram[f->bucket].fetch_add(1, std::memory_order_relaxed);
+    written.store(n + 1, std::memory_order_release);
+}
+
+//copies the frames in the ring out, oldest first, and returns how many there are. Any the game
+//loop started writing over while they were being copied are left out
+static int snapshot(framesample *out) {
+    unsigned end = written.load(std::memory_order_acquire);
+    unsigned start = end > (unsigned)perfFrames ? end - perfFrames : 0;
+    for (unsigned i=start; i<end; i++) out[i - start] = ring[i % perfFrames];
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    //the frame being written now is overwriting the one perfFrames before it
+    unsigned now = written.load(std::memory_order_relaxed);
+    unsigned safe = now >= (unsigned)perfFrames ? now - perfFrames + 1 : 0;
+    if (safe <= start) return end - start;
+    if (safe >= end) return 0;
+    memmove(out, out + (safe - start), sizeof(framesample) * (end - safe));
+    return end - safe;
+}
+
+//works out the numbers the overlay shows, rates are over the last second
+void perfsummarize(perfsummary *s) {
+    framesample frames[perfFrames];
+    int n = snapshot(frames);
+    memset(s, 0, sizeof(perfsummary));
+    s->frames = n;
+    if (n == 0) return;
+
+    double now = seconds(), window = now < 1 ? now : 1;
+    for (int i=n-1; i>=0 && frames[i].when > now - window; i--) {
+        s->ticksPerSecond += frames[i].ticks;
+        s->framesPerSecond++;
+    }
+    if (window > 0) {
+        s->ticksPerSecond /= window;
+        s->framesPerSecond /= window;
+    }
+
+    for (int i=0; i<n; i++)
+        for (int j=0; j<numPhases; j++) s->phase[j] += frames[i].phase[j] / n;
+
+    int counts[numBuckets], total = 0;
+    for (int b=0; b<numBuckets; b++) {
+        counts[b] = histogram[b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+    int seen = 0;
+    for (int b=0; b<numBuckets; b++) {
+        seen += counts[b];
+        if (s->p50 == 0 && seen * 2 >= total) s->p50 = bucketlimit(b);
+        if (s->p99 == 0 && seen * 100 >= total * 99) s->p99 = bucketlimit(b);
+    }
+}
+
+//keeps a figure to be saved with the frames, noting the same name again replaces it
+void perfnote(const char *name, double value) {
+    int i = 0;
+    while (i < numNotes && strcmp(notes[i].name, name) != 0) i++;
+    if (i == perfNotes) return;
+    if (i == numNotes) numNotes++;
+    notes[i].name = name;
+    notes[i].value = value;
+}
+
+//saves the histogram of the remembered frames as CSV, with the average split of the frames in each bucket,
+//then the figures from perfnote() as a second table
+bool perfdump(const char *path) {
+    framesample frames[perfFrames];
+    int n = snapshot(frames);
+    if (n == 0 && numNotes == 0) return true;
+
+    int counts[numBuckets] = {0};
+    double split[numBuckets][numPhases] = {{0}};
+    for (int i=0; i<n; i++) {
+        int b = frames[i].bucket;
+        counts[b]++;
+        for (int j=0; j<numPhases; j++) split[b][j] += frames[i].phase[j];
+    }
+
+    FILE *f = fopen(path, "w");
+    if (f == NULL) return false;
+    fprintf(f, "from_ms,to_ms,frames,input_ms,logic_ms,render_ms,blit_ms\n");
+    for (int b=0; b<numBuckets; b++) {
+        if (counts[b] == 0) continue;
+        fprintf(f, "%.4f,%.4f,%d", b > 0 ? bucketlimit(b - 1) : 0, bucketlimit(b), counts[b]);
+        for (int j=0; j<numPhases; j++) fprintf(f, ",%.4f", split[b][j] / counts[b]);
+        fprintf(f, "\n");
+    }
+    if (numNotes > 0) fprintf(f, "\nfigure,value\n");
+    for (int i=0; i<numNotes; i++) fprintf(f, "%s,%.4f\n", notes[i].name, notes[i].value);
+    return fclose(f) == 0;
+}
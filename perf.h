@@ -0,0 +1,44 @@
+/* Eddy Gao                     Serpens - Performance counters               ICS3U
+Keeps track of how long every frame of the game takes, split into reading input,
+running the game logic, drawing into the buffer and copying it to the screen. The
+last perfFrames frames are kept in a ring along with a histogram of how long they
+took, so the overlay can show percentiles and the whole lot can be saved to a CSV
+file when the game closes. Figures that aren't about any one frame, like the tick
+jitter, are noted down with perfnote() and saved in the same file. Only the game loop writes to the ring, and it never
+waits on anyone reading it, so it can be read from any thread.
+*/
+#ifndef PERF_H
+#define PERF_H
+
+//how many frames are remembered
+const int perfFrames = 1024;
+
+//the parts of a frame that get timed
+enum Phase {
+    PhaseInput = 0,
+    PhaseLogic,
+    PhaseRender,
+    PhaseBlit,
+    numPhases
+};
+
+//the most figures perfnote() keeps
+const int perfNotes = 16;
+
+//what the overlay shows, times are in milliseconds
+typedef struct perfsummary {
+    double ticksPerSecond, framesPerSecond;
+    double p50, p99;            //frame times, to the nearest histogram bucket
+    double phase[numPhases];    //average time spent on each phase per frame
+    int frames;                 //frames the summary is over
+} perfsummary;
+
+void perfbegin();
+void perfmark(int phase);
+void perftick();
+void perfframe();
+void perfsummarize(perfsummary *s);
+void perfnote(const char *name, double value);
+bool perfdump(const char *path);
+
+#endif
@@ -0,0 +1,78 @@
+/* Eddy Gao                     Serpens - Thread pool                        ICS3U
+The work stealing thread pool. See pool.h.
+*/
+#include <thread>
+#include <mutex>
+#include <vector>
+#include "pool.h"
+
+//the jobs a thread still has to do, from begin up to end. The owner takes jobs off
+//the front, and other threads steal from the back
+typedef struct jobrange {
+    std::mutex lock;
+    int begin, end;
+    //keep every range on its own cache line so the threads don't slow each other down
+    char padding[64];
+} jobrange;
+
+//the number of threads the computer can run at once
+int numcores() {
+    int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+static bool takejob(jobrange *r, int *job) {
+    std::lock_guard<std::mutex> hold(r->lock);
+    if (r->begin == r->end) return false;
+    *job = r->begin++;
+    return true;
+}
+
+//moves half of victim's jobs over to thief, returns false if there was nothing to take
+static bool steal(jobrange *victim, jobrange *thief) {
+    int begin, end;
+    {
+        std::lock_guard<std::mutex> hold(victim->lock);
+        int left = victim->end - victim->begin;
+        if (left == 0) return false;
+        end = victim->end;
+        begin = end - (left + 1) / 2;
+        victim->end = begin;
+    }
+    std::lock_guard<std::mutex> hold(thief->lock);
+    thief->begin = begin;
+    thief->end = end;
+    return true;
+}
+
+static void work(jobrange *ranges, int threads, int worker, jobfunc f, void *data) {
+    jobrange *mine = &ranges[worker];
+    int job;
+    while (true) {
+        while (takejob(mine, &job)) f(job, worker, data);
+
+        //out of work, go looking for some, starting with the next thread along
+        bool found = false;
+        for (int i=1; i<threads && !found; i++) {
+            found = steal(&ranges[(worker + i) % threads], mine);
+        }
+        if (!found) return;
+    }
+}
+
+//runs jobs 0 to jobs-1 on the given number of threads, and waits until they're all done
+void runjobs(int jobs, int threads, jobfunc f, void *data) {
+    if (threads < 1) threads = 1;
+    if (threads > jobs) threads = jobs > 0 ? jobs : 1;
+    std::vector<jobrange> ranges(threads);
+    for (int i=0; i<threads; i++) {
+        ranges[i].begin = (long)jobs * i / threads;
+        ranges[i].end = (long)jobs * (i + 1) / threads;
+    }
+
+    //this thread does a share of the work too
+    std::vector<std::thread> workers;
+    for (int i=1; i<threads; i++) workers.push_back(std::thread(work, ranges.data(), threads, i, f, data));
+    work(ranges.data(), threads, 0, f, data);
+    for (size_t i=0; i<workers.size(); i++) workers[i].join();
+}
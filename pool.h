@@ -0,0 +1,16 @@
+/* Eddy Gao                     Serpens - Thread pool                        ICS3U
+Runs a numbered list of jobs on every core. Each thread starts with an even share
+of the jobs, and when it runs out it steals half of what another thread has left,
+so the threads all finish at about the same time even when jobs take different
+amounts of time.
+*/
+#ifndef POOL_H
+#define POOL_H
+
+//a job, given its number, the number of the thread running it, and whatever was passed to runjobs
+typedef void (*jobfunc)(int job, int worker, void *data);
+
+int numcores();
+void runjobs(int jobs, int threads, jobfunc f, void *data);
+
+#endif
@@ -0,0 +1,283 @@
+/* Eddy Gao                     Serpens - Drawing                            ICS3U
+Drawing the game. See render.h.
+*/
+#include <allegro.h>
+#include <stdlib.h>
+#include "render.h"
+#include "trace.h"
+
+BITMAP *buffer;
+BITMAP *atlas;
+bool fancy = false;
+int color[3], backcol, snakecol, foodcol, msgcol;
+int playercol[maxSnakes];
+unsigned char *tiles;
+int mapw, maph;
+int camx, camy;
+bool wrapview;
+int dirtyx[maxDirty], dirtyy[maxDirty], numDirty;
+bool allDirty = true;
+
+//the colours of the snakes after the first in arena games, the first is the colour scheme's
+static const int playerColors[maxSnakes][3] = {
+    {0, 0, 0}, {230, 60, 60}, {60, 200, 60}, {70, 110, 240}, {230, 200, 40}, {200, 70, 220}, {40, 210, 210}, {240, 140, 40}
+};
+
+//works out the colours for the current colour scheme, and draws every tile with them once
+//so that the game only has to copy tiles around
+void makeatlas() {
+    backcol = makecol(color[0], color[1], color[2]);
+    snakecol = makecol((color[0] + 128) % 256, (color[1] + 128) % 256, (color[2] + 128) % 256);
+    foodcol = makecol((color[0] + 128) % 256, 255 - color[1], color[2]);
+    msgcol = makecol(255 - color[0], 255 - color[1], 255 - color[2]);
+    playercol[0] = snakecol;
+    for (int p=1; p<maxSnakes; p++) playercol[p] = makecol(playerColors[p][0], playerColors[p][1], playerColors[p][2]);
+
+    clear_to_color(atlas, backcol);
+    rectfill(atlas, TileVoid*20, 0, TileVoid*20 + 19, 19, makecol(0, 0, 0));
+    rectfill(atlas, TileWall*20, 0, TileWall*20 + 19, 19, snakecol);
+    circlefill(atlas, TileFood*20+9, 9, 9, foodcol);
+    circlefill(atlas, TileSpecial*20+9, 9, 9, foodcol);
+    circlefill(atlas, TileSpecial*20+9, 9, 6, snakecol);
+
+    //every snake gets its own row of tails and joints in its own colour
+    for (int p=0; p<maxSnakes; p++) {
+        int hy = p*20, col = playercol[p];
+
+        //fancy triangle tails, wide on the side the rest of the snake is on
+        for (int side=0; side<4; side++) {
+            int dx = (side == SideRight) - (side == SideLeft);
+            int dy = (side == SideDown) - (side == SideUp);
+            int hx = (TileTail + side)*20;
+            triangle(atlas, dx+dy==-1?hx:hx+19, dy+1==dx?hy:hy+19, dy+1==dx?hx+19:hx, dy+dx==-1?hy:hy+19, hx+9 - 9*dx, hy+9 - 9*dy, col);
+        }
+
+        //the head and body are a circle, filled out to the edge on every side that joins another segment
+        for (int sides=0; sides<16; sides++) {
+            int hx = (TileJoint + sides)*20;
+            circlefill(atlas, hx+9, hy+9, 9, col);
+            if (sides & (1 << SideUp)) rectfill(atlas, hx, hy, hx+19, hy+9, col);
+            if (sides & (1 << SideDown)) rectfill(atlas, hx, hy+10, hx+19, hy+19, col);
+            if (sides & (1 << SideLeft)) rectfill(atlas, hx, hy, hx+9, hy+19, col);
+            if (sides & (1 << SideRight)) rectfill(atlas, hx+10, hy, hx+19, hy+19, col);
+        }
+    }
+}
+
+//makes room for the tiles of a map of the given size, and fills in its walls
+static void layouttiles(engine *e) {
+    if (mapw != e->width || maph != e->height) {
+        free(tiles);
+        tiles = (unsigned char*)malloc(e->width * e->height);
+        mapw = e->width;
+        maph = e->height;
+    }
+    for (int i=0; i<maph; i++)
+        for (int j=0; j<mapw; j++) {
+            tiles[i*mapw + j] = getmap(e, j, i) == Snake ? TileWall : TileBack;
+        }
+}
+
+//lays out the map's tiles for a new game, and shows wherever the camera ends up
+void layout(engine *e) {
+    TRACE("layout");
+    layouttiles(e);
+    updatecamera(e->posx, e->posy, true);
+    for (int i=0; i<e->body.length; i++) drawsegment(&e->body, i, 0);
+    if (e->foodx!=-1) drawtile(TileFood, e->foodx, e->foody);
+    if (e->specx!=-1) drawtile(TileSpecial, e->specx, e->specy);
+}
+
+//draws what changed in a tick into buffer, given the events step() returned
+void drawevents(engine *e, int events) {
+    TRACE("drawevents");
+    if (events & TailMoved) {
+        //draw over the part that was left behind, and draw the new tail
+        drawtile(TileBack, e->leftover.x, e->leftover.y);
+        drawsegment(&e->body, 0, 0);
+    }
+
+    //when the board's been filled there's no new food, but the head still moved onto the last square
+    if ((events & Ate) && !(events & Won)) {
+        //draw the food that was just placed
+        drawtile(TileFood, e->foodx, e->foody);
+        if (e->specx!=-1) drawtile(TileSpecial, e->specx, e->specy);
+    }
+
+    //draw the snake's head, and join the square it came from up to it
+    if (events & Moved) {
+        drawsegment(&e->body, e->body.length-1, 0);
+        if (e->body.length > 1) drawsegment(&e->body, e->body.length-2, 0);
+    }
+
+    updatecamera(e->posx, e->posy, false);
+}
+
+//the snake the camera follows in an arena game, the first one that's still alive
+static player *followed(arena *a) {
+    for (int p=0; p<a->numPlayers; p++)
+        if (a->players[p].alive) return &a->players[p];
+    return &a->players[0];
+}
+
+//lays out an arena game, like layout()
+void layoutarena(arena *a) {
+    TRACE("layoutarena");
+    layouttiles(&a->board);
+    updatecamera(followed(a)->posx, followed(a)->posy, true);
+    for (int p=0; p<a->numPlayers; p++)
+        for (int i=0; i<a->players[p].body.length; i++) drawsegment(&a->players[p].body, i, p);
+    for (int i=0; i<a->numFood; i++)
+        if (a->foodx[i] != -1) drawtile(TileFood, a->foodx[i], a->foody[i]);
+}
+
+//draws what changed in an arena tick, like drawevents()
+void drawarena(arena *a) {
+    TRACE("drawarena");
+    //the snakes that died are gone, and so are the tails that moved on
+    for (int p=0; p<a->numPlayers; p++) {
+        player *pl = &a->players[p];
+        if (pl->events & TailMoved) drawtile(TileBack, pl->leftover.x, pl->leftover.y);
+        if (pl->events & Died) {
+            for (int i=0; i<pl->body.length; i++) drawtile(TileBack, getElem(&pl->body, i)->x, getElem(&pl->body, i)->y);
+        } else if (pl->events & TailMoved) drawsegment(&pl->body, 0, p);
+    }
+
+    //then the heads and the food that was put back, which could be on any of those squares
+    for (int p=0; p<a->numPlayers; p++) {
+        player *pl = &a->players[p];
+        if (!(pl->events & Moved)) continue;
+        drawsegment(&pl->body, pl->body.length-1, p);
+        if (pl->body.length > 1) drawsegment(&pl->body, pl->body.length-2, p);
+    }
+    for (int i=0; i<a->numFood; i++)
+        if (a->foodx[i] != -1 && tiles[a->foody[i]*mapw + a->foodx[i]] != TileFood) drawtile(TileFood, a->foodx[i], a->foody[i]);
+
+    updatecamera(followed(a)->posx, followed(a)->posy, false);
+}
+
+//puts a tile on a square of the map, and copies it from the atlas to everywhere that square is in the view
+void drawtile(int tile, int x, int y) {
+    tiles[y*mapw + x] = tile;
+    for (int vy = wrapmod(y - camy, maph); vy < viewHeight; vy += maph) {
+        for (int vx = wrapmod(x - camx, mapw); vx < viewWidth; vx += mapw) {
+            blit(atlas, buffer, tile % numTiles * 20, tile / numTiles * 20, vx*20, vy*20, 20, 20);
+            markdirty(vx, vy);
+            if (!wrapview) break;
+        }
+        if (!wrapview) break;
+    }
+}
+
+//which side of segment a the segment b is on, taking wrapping around the screen into account
+int sidetoward(segment *a, segment *b) {
+    int dx = b->x - a->x;
+    int dy = b->y - a->y;
+    if (dx > 1) dx = -1;
+    else if (dx < -1) dx = 1;
+    if (dy > 1) dy = -1;
+    else if (dy < -1) dy = 1;
+    if (dx) return dx == 1 ? SideRight : SideLeft;
+    return dy == 1 ? SideDown : SideUp;
+}
+
+//draws the i-th segment of a snake (counting from the tail) joined up to its neighbours,
+//in the colour of the given player
+void drawsegment(snake *body, int i, int player) {
+    int n = body->length, row = player * numTiles;
+    segment *s = getElem(body, i);
+    if (i == 0 && n > 1) {
+        drawtile(row + TileTail + sidetoward(s, getElem(body, 1)), s->x, s->y);
+        return;
+    }
+    int sides = 0;
+    if (i > 0) sides |= 1 << sidetoward(s, getElem(body, i-1));
+    if (i < n-1) sides |= 1 << sidetoward(s, getElem(body, i+1));
+    drawtile(row + TileJoint + sides, s->x, s->y);
+}
+
+//remembers that a square of buffer has to be shown again
+void markdirty(int x, int y) {
+    if (allDirty) return;
+    for (int i=0; i<numDirty; i++)
+        if (dirtyx[i] == x && dirtyy[i] == y) return;
+    if (numDirty == maxDirty) {
+        markall();
+        return;
+    }
+    dirtyx[numDirty] = x;
+    dirtyy[numDirty] = y;
+    numDirty++;
+}
+
+//the whole buffer has to be shown again
+void markall() {
+    allDirty = true;
+    numDirty = 0;
+}
+
+//shows the parts of buffer that changed on target, which is normally the screen
+void present(BITMAP *target) {
+    TRACE("blit");
+    if (allDirty) blit(buffer, target, 0, 0, 0, 0, buffer->w, buffer->h);
+    else {
+        //only copy the squares that changed
+        for (int i=0; i<numDirty; i++) {
+            blit(buffer, target, dirtyx[i]*20, dirtyy[i]*20, dirtyx[i]*20, dirtyy[i]*20, 20, 20);
+        }
+    }
+
+    allDirty = false;
+    numDirty = 0;
+}
+
+//a modulo m, but never negative
+int wrapmod(int a, int m) {
+    a %= m;
+    return a < 0 ? a + m : a;
+}
+
+//moves the camera to follow the snake's head, and redraws the view if it moved
+//fancy centred mode keeps the head in the middle, otherwise the view only moves if the map doesn't fit
+void updatecamera(int headx, int heady, bool force) {
+    bool wrap = fancy || mapw > viewWidth || maph > viewHeight;
+    int x = camx, y = camy;
+
+    if (fancy) {
+        x = headx - viewWidth/2;
+        y = heady - viewHeight/2;
+    } else {
+        //jump to put the head back in the middle whenever it gets near an edge
+        int vx = wrapmod(headx - camx, mapw);
+        int vy = wrapmod(heady - camy, maph);
+        if (mapw <= viewWidth) x = 0;
+        else if (force || vx < scrollMargin || vx >= viewWidth - scrollMargin) x = headx - viewWidth/2;
+        if (maph <= viewHeight) y = 0;
+        else if (force || vy < scrollMargin || vy >= viewHeight - scrollMargin) y = heady - viewHeight/2;
+    }
+    x = wrapmod(x, mapw);
+    y = wrapmod(y, maph);
+
+    if (force || x != camx || y != camy || wrap != wrapview) {
+        camx = x;
+        camy = y;
+        wrapview = wrap;
+        redrawview();
+    }
+}
+
+//draws every square of the view again from the tiles
+void redrawview() {
+    TRACE("redrawview");
+    for (int vy=0; vy<viewHeight; vy++) {
+        int y = camy + vy;
+        if (wrapview) y %= maph;
+        for (int vx=0; vx<viewWidth; vx++) {
+            int x = camx + vx;
+            if (wrapview) x %= mapw;
+            int tile = (x < mapw && y < maph) ? tiles[y*mapw + x] : TileVoid;
+            blit(atlas, buffer, tile % numTiles * 20, tile / numTiles * 20, vx*20, vy*20, 20, 20);
+        }
+    }
+    markall();
+}
@@ -0,0 +1,85 @@
+/* Eddy Gao                     Serpens - Drawing                            ICS3U
+Drawing the game. Every tile is drawn once into an atlas in the current colours,
+and the view is put together in buffer by copying tiles out of it. The atlas has a
+row of snake tiles for every snake there can be in an arena game, a tile in row p
+is numbered p*numTiles + its Tile. Only the
+squares that changed get drawn each tick, and only the ones that were drawn on
+get copied to the screen, unless the view moved and all of it has to be.
+*/
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <allegro.h>
+#include "engine.h"
+#include "arena.h"
+
+//screen constants, the view is the part of the screen the map is shown in
+const int scrx = 480, scry = 640;
+const int viewWidth = scrx/20, viewHeight = (scry-40)/20;
+
+//how close the head can get to the edge of the view before it scrolls, on maps that don't fit
+const int scrollMargin = 4;
+
+//the most squares that get shown one by one before it's quicker to show the whole buffer
+const int maxDirty = 32;
+
+//sides of a square, a snake segment joins its neighbours on some of these
+enum Side {
+    SideUp = 0,
+    SideDown,
+    SideLeft,
+    SideRight
+};
+
+//tiles in the atlas, there are 4 tails (one for each side) and 16 joints (one for each combination of sides)
+enum Tile {
+    TileBack = 0,
+    TileWall,
+    TileFood,
+    TileSpecial,
+    TileTail,
+    TileJoint = TileTail + 4,
+    TileVoid = TileJoint + 16,
+    numTiles
+};
+
+//size of the atlas
+const int atlasWidth = numTiles*20, atlasHeight = maxSnakes*20;
+
+extern BITMAP *buffer; // game buffer
+extern BITMAP *atlas;  // every tile, pre-rendered in the current colours
+
+//fancy centred viewmode, and the colour scheme
+extern bool fancy;
+extern int color[3], backcol, snakecol, foodcol, msgcol;
+extern int playercol[maxSnakes];    //the colour of each snake in an arena game
+
+//the tile showing on every square of the map, and the size of the map it was made for
+extern unsigned char *tiles;
+extern int mapw, maph;
+
+//square of the map shown in the top left corner of the view, and whether the view
+//wraps around the edges of the map (if it doesn't, anything past the edge is void)
+extern int camx, camy;
+extern bool wrapview;
+
+//squares of the view that were drawn on since buffer was last shown
+extern int dirtyx[maxDirty], dirtyy[maxDirty], numDirty;
+extern bool allDirty;
+
+void makeatlas();
+void layout(engine *e);
+void drawevents(engine *e, int events);
+void layoutarena(arena *a);
+void drawarena(arena *a);
+void drawtile(int tile, int x, int y);
+int sidetoward(segment *a, segment *b);
+void drawsegment(snake *body, int i, int player);
+void markdirty(int x, int y);
+void markall();
+void present(BITMAP *target);
+int wrapmod(int a, int m);
+void updatecamera(int headx, int heady, bool force);
+void redrawview();
+
+#endif
@@ -0,0 +1,154 @@
+/* Eddy Gao                     Serpens - Replays                            ICS3U
+Replay recording and playback. See replay.h.
+
+Replay files are laid out like this:
+    "SREP"              magic
+    version             always 1, 32 bit little endian
+    seed                64 bit little endian
+    name length         one byte, followed by the map's name
+    length, turns       varints, the number of ticks and the number of turns
+Then every turn as a varint of (ticks since the last turn << 2) | (direction - 1).
+A varint is 7 bits a byte, lowest first, with the top bit set on every byte but
+the last, so most turns take a single byte.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+
+void rinit(replay *r) {
+    r->seed = 0;
+    r->map[0] = '\0';
+    r->turns = NULL;
+    r->numTurns = r->capacity = 0;
+    r->length = 0;
+    r->next = 0;
+}
+
+void rdestroy(replay *r) {
+    free(r->turns);
+    rinit(r);
+}
+
+//empties a replay to start recording a new game, keeping its memory
+void rstart(replay *r, const char *map, uint64_t seed) {
+    r->seed = seed;
+    strncpy(r->map, map, maxReplayName);
+    r->map[maxReplayName] = '\0';
+    r->numTurns = 0;
+    r->length = 0;
+    r->next = 0;
+}
+
+//adds a turn to the end of the replay, turns have to be recorded in order
+bool rrecord(replay *r, int tick, int direction) {
+    if (r->numTurns == r->capacity) {
+        int capacity = r->capacity ? r->capacity * 2 : 256;
+        turn *turns = (turn*)realloc(r->turns, sizeof(turn) * capacity);
+        if (turns == NULL) return false;
+        r->turns = turns;
+        r->capacity = capacity;
+    }
+    r->turns[r->numTurns].tick = tick;
+    r->turns[r->numTurns].direction = direction;
+    r->numTurns++;
+    return true;
+}
+
+static void writevarint(FILE *f, uint64_t n) {
+    while (n >= 128) {
+        fputc((int)(n & 127) | 128, f);
+        n >>= 7;
+    }
+    fputc((int)n, f);
+}
+
+static bool readvarint(FILE *f, uint64_t *n) {
+    *n = 0;
+    for (int shift=0; shift<64; shift+=7) {
+        int c = fgetc(f);
+        if (c == EOF) return false;
+        *n |= (uint64_t)(c & 127) << shift;
+        if (!(c & 128)) return true;
+    }
+    return false;
+}
+
+bool rsave(const replay *r, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) return false;
+
+    int nameLength = strlen(r->map);
+    fwrite("SREP", 1, 4, f);
+    for (int i=0; i<4; i++) fputc(i == 0, f);
+    for (int i=0; i<8; i++) fputc((int)(r->seed >> (i*8)) & 255, f);
+    fputc(nameLength, f);
+    fwrite(r->map, 1, nameLength, f);
+    writevarint(f, r->length);
+    writevarint(f, r->numTurns);
+
+    int last = 0;
+    for (int i=0; i<r->numTurns; i++) {
+        writevarint(f, ((uint64_t)(r->turns[i].tick - last) << 2) | (r->turns[i].direction - 1));
+        last = r->turns[i].tick;
+    }
+    return fclose(f) == 0;
+}
+
+bool rload(replay *r, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+
+    unsigned char header[17];
+    uint64_t length, count, n;
+    bool ok = fread(header, 1, 17, f) == 17 && memcmp(header, "SREP", 4) == 0
+           && header[4] == 1 && header[5] == 0 && header[6] == 0 && header[7] == 0;
+    if (ok) {
+        uint64_t seed = 0;
+        for (int i=0; i<8; i++) seed |= (uint64_t)header[8 + i] << (i*8);
+        char name[maxReplayName + 1];
+        int nameLength = header[16];
+        ok = (int)fread(name, 1, nameLength, f) == nameLength
+          && readvarint(f, &length) && readvarint(f, &count)
+          && length <= 0x7fffffff && count <= length;
+        name[ok ? nameLength : 0] = '\0';
+        rstart(r, name, seed);
+    }
+
+    //turn the tick deltas back into ticks, they can never go backwards or past the end
+    int tick = 0;
+    for (uint64_t i=0; ok && i<count; i++) {
+        ok = readvarint(f, &n) && (n >> 2) <= length - tick;
+        if (ok) {
+            tick += (int)(n >> 2);
+            ok = rrecord(r, tick, (int)(n & 3) + 1);
+        }
+    }
+    if (ok) r->length = (int)length;
+    fclose(f);
+    return ok;
+}
+
+//goes back to the start of the replay to play it again
+void rrewind(replay *r) {
+    r->next = 0;
+}
+
+//the direction to give step() on the given tick, None if the player didn't turn then
+int rdirection(replay *r, int tick) {
+    while (r->next < r->numTurns && r->turns[r->next].tick < tick) r->next++;
+    if (r->next < r->numTurns && r->turns[r->next].tick == tick) return r->turns[r->next++].direction;
+    return None;
+}
+
+//plays up to the given number of ticks of a replay without drawing anything, stopping early
+//at the end of the replay or when the game ends. The engine has to have been started with
+//newgame() on the replay's map and seed. Returns the events of the last tick played
+int rplay(engine *e, replay *r, int ticks) {
+    int events = 0;
+    for (int i=0; i<ticks && e->tick < r->length; i++) {
+        events = step(e, rdirection(r, e->tick));
+        if (events & (Died | Won)) break;
+    }
+    return events;
+}
@@ -0,0 +1,41 @@
+/* Eddy Gao                     Serpens - Replays                            ICS3U
+Recording and playing back games. Since the engine is deterministic, a game is
+completely described by its seed, its map and the turns the player made, so that
+is all a replay keeps. Playback feeds the turns back into step() on the tick they
+were made, so it runs as fast as the engine does when nothing is drawn.
+*/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include "engine.h"
+
+//longest map name a replay will store
+const int maxReplayName = 255;
+
+//a direction the player turned in, and the tick it was made on (e->tick before the step)
+typedef struct turn {
+    int tick;
+    int direction;
+} turn;
+
+typedef struct replay {
+    uint64_t seed;
+    char map[maxReplayName + 1];    //the map's file name inside maps/
+    turn *turns;
+    int numTurns, capacity;
+    int length;                     //number of ticks the game lasted
+    int next;                       //the next turn to play back
+} replay;
+
+void rinit(replay *r);
+void rdestroy(replay *r);
+void rstart(replay *r, const char *map, uint64_t seed);
+bool rrecord(replay *r, int tick, int direction);
+bool rsave(const replay *r, const char *path);
+bool rload(replay *r, const char *path);
+void rrewind(replay *r);
+int rdirection(replay *r, int tick);
+int rplay(engine *e, replay *r, int ticks);
+
+#endif
@@ -0,0 +1,37 @@
+/* Eddy Gao                     Serpens - Random numbers                     ICS3U
+A small seedable random number generator (PCG32), so that a game can be played
+again exactly from its seed. Every engine has its own, nothing is shared.
+*/
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+typedef struct rng {
+    uint64_t state;
+    uint64_t inc;
+} rng;
+
+//gets the next 32 random bits
+inline uint32_t rngnext(rng *r) {
+    uint64_t old = r->state;
+    r->state = old * 6364136223846793005ULL + r->inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+inline void rngseed(rng *r, uint64_t seed) {
+    r->state = 0;
+    r->inc = (seed << 1) | 1;
+    rngnext(r);
+    r->state += seed ^ 0x853c49e6748fea9bULL;
+    rngnext(r);
+}
+
+//gets a random number from 0 to n-1
+inline int rngrange(rng *r, int n) {
+    return (int)(((uint64_t)rngnext(r) * (uint32_t)n) >> 32);
+}
+
+#endif
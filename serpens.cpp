@@ -3,10 +3,18 @@ This game is based on the classic arcade game, "Snake". The player controls a
 hungry snake, whose tail grows whenever it eats. If the snake collides with
 itself or the wall, the game is over.
 Additional features include:
-    Ability to load custom maps 
+    Ability to load custom maps, picked from a grid of previews
     Separate map editor tool to create maps
     Special foods with decaying benefit
     Fancy centred viewmode
+    Replays of the last game (R in the menu, hold F to fast forward)
+    Autopilot that finds the shortest way to the food (A to toggle)
+    Performance overlay in the status bar (P to toggle), saved to perf.csv on exit
+    Quick save and quick load (F5 and F9), which carry on between runs
+    Arena games for 2 to 8 snakes (press 2 to 8 in the menu), the first two are
+    played with the arrow keys and WASD and the rest are bots (B for all bots)
+    A demo that always fills the board (D in the menu), by following a loop
+    through every square of the map that's worked out when the map is loaded
 */
 
 #include <allegro.h>
@@ -15,82 +23,215 @@ Additional features include:
 #include <time.h>
 #include <string.h>
 #include <stdlib.h>
-#define BACKCOL makecol(color[0], color[1], color[2])
-#define SNAKECOL makecol((color[0] + 128) % 256, (color[1] + 128) % 256, (color[2] + 128) % 256)
-#define FOODCOL makecol((color[0] + 128) % 256, 255 - color[1], color[2])
-#define MSGCOL makecol(255 - color[0], 255 - color[1], 255 - color[2])
-
-//structure to store a snake segment, this is used in a linked list to represent the snake
-typedef struct snake {
-    int x;
-    int y;
-    struct snake *next;
-} snake;
-
-//screen constants
-const int scrx = 480, scry = 640;
-const int gridWidth = 24, gridHeight = 30;
-
-//types of grid squares
-enum GridSquare {
-    Empty = 0,
-    Snake,
-    Food,
-    Infertile,
-    Special
-};
-
-BITMAP *buffer; // game buffer
-
-//grid stores current state, map stores the initial state
-GridSquare grid[gridHeight][gridWidth];
-GridSquare  map[gridHeight][gridWidth];
+#include <chrono>
+#include "engine.h"
+#include "render.h"
+#include "replay.h"
+#include "path.h"
+#include "events.h"
+#include "assets.h"
+#include "mapindex.h"
+#include "perf.h"
+#include "trace.h"
+#include "snapshot.h"
+#include "arena.h"
+#include "cycle.h"
+
+//timing constants, the most missed ticks to make up after a stall and the most frames to show per second
+const int maxCatchup = 5, maxFPS = 60;
+
+//the most turns that can be waiting to be made, one is made each tick
+const int maxQueued = 4;
+
+//the map picker shows this many maps across and down, in cells this big under a 40 pixel title
+const int pickerColumns = 3, pickerRows = 3;
+const int cellWidth = scrx/pickerColumns, cellHeight = (scry-40)/pickerRows;
+
+//where the index of maps/ is kept between runs
+const char indexFile[] = "maps/index.dat";
+
+//where the last game is recorded to, and how many times faster a replay runs with F held
+const char replayFile[] = "last.srep";
+const int fastForward = 16;
+
+//where the frame time histogram is saved on exit, and how often the overlay is redrawn in milliseconds
+const char perfFile[] = "perf.csv";
+const int overlayInterval = 250;
+
+//where the quick save is kept between runs
+const char quickFile[] = "quick.ssav";
+
+//arena games run at the speed a single snake starts at, and have this many players at the keyboard
+const int arenaSpeed = 10, arenaHumans = 2;
+
+//how long the demo shows the filled board for before it starts again, in milliseconds
+const int demoPause = 3000;
+
+//where T saves the trace to, when tracing is built in (see trace.h)
+const char traceFile[] = "serpens.trace.json";
+
+//the state of the game itself, see engine.h
+engine world;
+
+//picks the seed for every new game, and the turns made in the current one
+rng seeds;
+replay recording;
+
+//the quick save, kept in memory as well as in quickFile. turns is how long the recording was
+//when it was saved, so that loading it can put the recording back the way it was too
+typedef struct quicksave {
+    engine state;
+    int color[3];
+    char map[maxMapName+1];
+    int turns;
+    bool saved;
+} quicksave;
+quicksave quick;
+
+//whether the recording can still play back the current game, it can't once a quick save
+//from another game has been loaded
+bool recordable = true;
+
+//the game with more than one snake, see arena.h
+arena battle;
+
+//the autopilot, whether it's steering, and how long its last search took in milliseconds
+pathfinder pilot;
+bool autopilot = false;
+double searchTime;
+
+//whether the demo is playing, the snake follows the map's cycle (see cycle.h) instead of the keyboard
+bool demoing = false;
+
+//whether the performance overlay is showing, and when it was last drawn
+bool overlay = false;
+std::chrono::steady_clock::time_point overlayDrawn;
+
+//every map in maps/, for the map picker
+mapindex mapIndex;
 
 //global variables
 bool quit = false;
-int spawnx, spawny, color[3];
+std::chrono::steady_clock::time_point launched;  //when the program started, for timing how long it takes to start
+
+//the game logic runs off a timer so that every tick is the same length no matter how long
+//drawing takes, these count the ticks and frames that are due but haven't been done yet
+volatile int pendingTicks = 0, pendingFrames = 0;
+
+//how far the time between two ticks was from what it should have been, in milliseconds
+typedef struct jitterstats {
+    double last, mean, worst;
+    int count;
+    bool restart;  //set when the next tick shouldn't count, like after a pause
+    std::chrono::steady_clock::time_point lastTick;
+} jitterstats;
+jitterstats jitter;
+
+//turns that have been pressed but not made yet, oldest first, and when they were pressed
+typedef struct turnqueue {
+    int directions[maxQueued];
+    std::chrono::steady_clock::time_point pressed[maxQueued];
+    int start, length;
+} turnqueue;
+turnqueue turns;
+
+//how long it took from a turn being pressed to it being shown on the screen, in milliseconds
+typedef struct latencystats {
+    double mean, worst;
+    int count;
+    //when the turns that have been made but not shown yet were pressed
+    std::chrono::steady_clock::time_point unshown[maxQueued];
+    int numUnshown;
+} latencystats;
+latencystats latency;
 
 //prototyping 
-void placefood(int *foodx, int *foody, int *specx, int *specy);
-snake *getElem(snake *L, int i);
-void sappend(snake** L, int x, int y, snake *newNode);
-void lose(int score, int color[]);
-bool loadMap(const char* lastFile);
-void reset(const char* lastFile, int *foodx, int *foody, int *posx, int *posy, int *velx, int *vely, int *score, int *extend, snake **tail, int *speed, int *numElem);
+void lose(int score, bool won = false);
+void reset(engine *e, uint64_t seed);
+void pickcolors(uint64_t seed);
+void newround(engine *e, const char *lastFile, replay *playback);
+void quicksaveto(engine *e);
+bool quickloadfrom(engine *e, char *lastFile);
+void drawstatus(engine *e);
+BITMAP *makethumb(mapinfo *m);
 void close();
+void tickTimer();
+void frameTimer();
 void load(char* out);
-void game(char *lastFile);
+void game(char *lastFile, replay *playback = NULL);
+void watch(char *lastFile);
+void versus(int snakes);
+void demo(char *lastFile);
+bool arenaturn(int code, int *directions);
+void drawscores(arena *a);
+int update(engine *e, SAMPLE *eat, char *lastFile, replay *playback);
+void timeTick(int rate);
+int heading(engine *e);
+void queueturn(engine *e, int direction, std::chrono::steady_clock::time_point when);
+void clearturns();
+void turnsshown();
 void menu();
 
 
 int main() {
-    //seed RNG
-    srand(time(0));
+    //start reading in the pictures and sounds while allegro starts up
+    launched = std::chrono::steady_clock::now();
+    startassets();
+
+    //seed RNG, every game gets its own seed from this so it can be replayed
+    rngseed(&seeds, time(0));
+    rinit(&recording);
+    einit(&quick.state);
+    pinit(&pilot);
+    initindex(&mapIndex);
+    loadindex(&mapIndex, indexFile);
     
     //a bunch of allegro initialization routines
     allegro_init();
     install_sound(DIGI_AUTODETECT, MIDI_AUTODETECT, NULL);
+    install_timer();
     install_keyboard();
     install_mouse();
+    installevents();
     show_mouse(screen);
     set_color_depth(desktop_color_depth());
     set_gfx_mode(GFX_AUTODETECT_WINDOWED, scrx, scry, 0, 0);
     set_close_button_callback(close);
-    
-    //play bg music
-    MIDI *music = load_midi("tetris.mid");
-    play_midi(music, 1);
+
+    //timers
+    LOCK_VARIABLE(pendingTicks);
+    LOCK_VARIABLE(pendingFrames);
+    LOCK_FUNCTION(tickTimer);
+    LOCK_FUNCTION(frameTimer);
     
     // Set the window title
     set_window_title("Serpens");
     
     buffer = create_bitmap(scrx, scry-40);
+    atlas = create_bitmap(atlasWidth, atlasHeight);
+    einit(&world);
+    ainit(&battle);
+    //the map that's there before one is picked isn't from a file, so its cycle isn't kept
+    hstart(&world, NULL);
     
     menu();
 
     //clean up
-    destroy_midi(music);
+    hstop();
+    edestroy(&world);
+    adestroy(&battle);
+    rdestroy(&recording);
+    edestroy(&quick.state);
+    pdestroy(&pilot);
+    freeindex(&mapIndex);
+    stop_midi();
+    stopassets();
+    free(tiles);
+    destroy_bitmap(atlas);
     destroy_bitmap(buffer);
+    removeevents();
+    perfnote("cpu_usage_percent", cpuusage());
+    if (!perfdump(perfFile)) printf("could not save %s\n", perfFile);
     return 0;
 }
 END_OF_MAIN()
@@ -100,414 +241,713 @@ void close() {
     quit=true;
 	//quit some menus
 	simulate_keypress(KEY_ESC << 8);
+    wakeevents();
 }
 
-//This function replaces the food, and has a chance of spawning a special food
-void placefood(int *foodx, int *foody, int *specx, int *specy) {
-    do {
-        *foodx = rand() % gridWidth;
-        *foody = rand() % gridHeight;
-    } while (grid[*foody][*foodx] != Empty);
-    grid[*foody][*foodx] = Food;
-
-    //20% chance of special food, and only if it isn't already there
-    if (rand()%10<2 && *specx == -1) {
-        do {
-            *specx = rand() % gridWidth;
-            *specy = rand() % gridHeight;
-        } while (grid[*specy][*specx] != Empty);
-        grid[*specy][*specx] = Special;
-    }
+//timer callbacks, these run on allegro's timer and shouldn't do anything but count and wake the game up
+void tickTimer() {
+    pendingTicks++;
+    wakeevents();
 }
+END_OF_FUNCTION(tickTimer)
 
-//appends a snake element to the end of the linked list, or the beginning of the snake
-void sappend(snake** L, int x, int y, snake *newNode) {
-    if (newNode == NULL) newNode = (snake*)malloc(sizeof(snake));
-    snake* temp = *L;
-    if (temp != NULL) {
-        while (temp->next != NULL) {
-            temp = temp->next;
-        }
-        // Creates a node at the end of the list
-        temp->next = newNode;
-        temp = temp->next;
-    } else {
-        temp = *L = newNode;
-    }
-    temp->next = NULL;
-    temp->x = x;
-    temp->y = y;
+void frameTimer() {
+    pendingFrames++;
+    wakeevents();
 }
+END_OF_FUNCTION(frameTimer)
 
-//prints loss message and keeps it there
-void lose(int score, int color[]) {
-    textprintf_centre_ex(screen, font, scrx / 2, 200, MSGCOL, -1, "You Lose! Final Score: %d", score);
-    textprintf_centre_ex(screen, font, scrx / 2, 250, MSGCOL, -1, "Press Space to Restart");
+//prints loss (or win, if the board was filled) message and keeps it there
+void lose(int score, bool won) {
+    TRACE("lose");
+    textprintf_centre_ex(screen, font, scrx / 2, 200, msgcol, -1, "You %s! Final Score: %d", won ? "Win" : "Lose", score);
+    textprintf_centre_ex(screen, font, scrx / 2, 250, msgcol, -1, "Press Space to Restart");
     while (true) {
-        int key = readkey();
+        int key = waitkey();
         if ((key & 0xFF) == ' ' || ((key >> 8) & 0xFF) == KEY_ESC) break;
     }
 }
 
-//handles map loading
-bool loadMap(char* input) {
-    char tile;
-    FILE* inputfile = fopen(input, "r");
-    
-    //make sure that we get a valid file
-    if (inputfile==NULL) {
-        return false;
-    }
-    
-    //read in map data
-    for (int y=0; y<30; y++) {
-        for (int x=0; x<24; x++) {
-            if (fscanf(inputfile, "%c", &tile) != 1) {
-                fclose(inputfile);
-                return false;
-            }
-            switch (tile) {
-            case '\r':
-            case '\n':
-                x--;
-                continue;
-            case 's':
-                spawnx=x;
-                spawny=y;
-                //no break, we want to set it to empty as well
-            case '.':
-                grid[y][x] = Empty;
-                map[y][x] = Empty;
-                break;
-            case '#':
-                //note that the walls are to be represented as immobile snakes
-                grid[y][x] = Snake;
-                map[y][x] = Snake;
-                rectfill(buffer, x*20, y*20, x*20 + 19, y*20 + 19, SNAKECOL);
-                break;
-            case 'x':
-                //food cannot spawn on these tiles, otherwise similar to empty
-                grid[y][x] = Infertile;
-                map[y][x] = Infertile;
-                break;
-            default:
-                grid[y][x] = Empty;
-                map[y][x] = Empty;
-            }
-        }
-    }
-
-    fclose(inputfile);
-    return true;
+//picks a new colour scheme and redraws everything for a new round started from seed
+void reset(engine *e, uint64_t seed) {
+    TRACE("reset");
+    pickcolors(seed);
+    newgame(e, seed);
+    layout(e);
+    drawstatus(e);
 }
 
-//resets several variables to initial values
-void reset(int *foodx, int *foody, int *specx, int *specy, int *posx, int *posy, int *velx, int *vely, int *score, int *extend, snake **tail, float *speed, int *numElem) {
-    *velx = 0;
-    *vely = 0;
-    color[0] = rand() % 128;
-    color[1] = rand() % 128;
-    color[2] = rand() % 128;
-    if (rand() & 1) {
+//the colours come from the seed too, so a replay looks the same as the game did
+void pickcolors(uint64_t seed) {
+    rng r;
+    rngseed(&r, seed);
+    color[0] = rngrange(&r, 128);
+    color[1] = rngrange(&r, 128);
+    color[2] = rngrange(&r, 128);
+    if (rngnext(&r) & 1) {
         color[0] += 128;
         color[1] += 128;
         color[2] += 128;
     }
-    clear_to_color(buffer, BACKCOL);
-    for (int i=0; i<gridHeight; i++)
-        for (int j=0; j<gridWidth; j++) {
-            grid[i][j] = map[i][j];
-            if (map[i][j] == Snake) rectfill(buffer, j*20, i*20, j*20 + 19, i*20 + 19, SNAKECOL);
-        }
-    grid[spawny][spawnx] = Snake;
-    *extend = 10;
-    *score = 0;
-    *posx = spawnx;
-    *posy = spawny;
-    *specx = -1;
-    *specy = -1;
-    *speed = 10;
-    *numElem=1;
-    sappend(tail, *posx, *posy, NULL);
-    placefood(foodx, foody, specx, specy);
-    circlefill(buffer, *posx*20+9, *posy*20+9, 9, SNAKECOL);
-    if (*specx!=-1) {
-        grid[*specy][*specx] = map[*specy][*specx];
-        *specx=-1;
-        *specy=-1;
-    }
-    circlefill(buffer, *foodx*20+9, *foody*20+9, 9, FOODCOL);
-    rectfill(screen, 0, 600, 480, 640, BACKCOL);
-    textprintf_ex(screen, font, 0, 620, MSGCOL, -1, "Score: 0");
+    makeatlas();
 }
 
+//makes a bitmap out of a map's thumbnail, in the same colours the mapmaker uses
+BITMAP *makethumb(mapinfo *m) {
+    int colors[4] = {makecol(200, 200, 200), makecol(10, 10, 10), makecol(50, 20, 230), makecol(200, 60, 20)};
+    BITMAP *thumb = create_bitmap(m->thumbw, m->thumbh);
+    for (int y=0; y<m->thumbh; y++)
+        for (int x=0; x<m->thumbw; x++) {
+            putpixel(thumb, x, y, colors[m->thumb[y*m->thumbw + x] & 3]);
+        }
+    return thumb;
+}
 
-//graphical text input to load a file
+//lets the player pick one of the maps in maps/ from a grid of pictures of them, and loads it.
+//out gets the map's file name, or is left empty if no map was picked
 void load(char* out) {
-    char text[PATH_MAX];
-    char tmp[PATH_MAX];
-    int pos = 0;
-    BITMAP* temp = create_bitmap(370, 200);
-    BITMAP* prompt = load_bitmap("prompt.bmp", NULL);
-    
-    draw_sprite(screen, prompt, 60, 160);
-    
-    while (!quit) {
-        pos=0;
-        text[0]='\0';
-        while (!quit) {
-            clear_to_color(temp, makecol(227, 227, 65));
-            textprintf_centre_ex(temp, font,  370/2, 55, makecol(0, 130, 65), -1, "%s", text);
-            blit(temp, screen, 0, 0, 60, 250, 370, 200);
-            
-            while (!keypressed()) rest(1);
-                        int  key = readkey();
-            char ASCII = key & 0xff;
-            char scancode = key >> 8;
-
-            // character key pressed
-            if (ASCII >= 32 && ASCII <= 126) {
-                if (pos < 29) {
-                    text[pos] = ASCII;
-                    pos++;
-                    text[pos] = '\0';
-                }
-            } else if (scancode == KEY_BACKSPACE) {
-                if (pos > 0) pos--;
-                text[pos] = '\0';
-            } else if (scancode == KEY_ENTER) {
+    BITMAP *page = create_bitmap(scrx, scry);
+    int back = makecol(227, 227, 65), text = makecol(0, 130, 65);
+    char path[PATH_MAX], message[PATH_MAX] = "";
+    int selected = 0, first = 0, oldz = mouse_z;
+    bool clicked = mouse_b & 1, done = false;
+
+    //only the maps that changed since the last time have to be read
+    if (updateindex(&mapIndex, "maps") >= 0) saveindex(&mapIndex, indexFile);
+    //files that aren't maps are kept at the end of the index, the picker stops before them
+    int count = mapIndex.usable;
+    int lastRow = count > 0 ? (count - 1) / pickerColumns : 0;
+    BITMAP **thumbs = (BITMAP**)calloc(count > 0 ? count : 1, sizeof(BITMAP*));
+
+    out[0] = '\0';
+    while (!quit && !done) {
+        //keep the selected map on the screen
+        int row = selected / pickerColumns;
+        if (row < first) first = row;
+        if (row >= first + pickerRows) first = row - pickerRows + 1;
+
+        clear_to_color(page, back);
+        textprintf_ex(page, font, 10, 8, text, -1, "%s", message[0] ? message : "Pick a map: arrows to move, Enter to play, Esc to go back");
+        textprintf_ex(page, font, 10, 24, text, -1, "%d of %d", count > 0 ? selected + 1 : 0, count);
+        if (count == 0) textprintf_centre_ex(page, font, scrx/2, scry/2, text, -1, "There are no maps in maps/");
+        for (int i = first*pickerColumns; i < count && i < (first + pickerRows)*pickerColumns; i++) {
+            mapinfo *m = &mapIndex.maps[i];
+            int cx = (i % pickerColumns) * cellWidth, cy = 40 + (i / pickerColumns - first) * cellHeight;
+            if (i == selected) {
+                rect(page, cx+2, cy+2, cx+cellWidth-3, cy+cellHeight-3, text);
+                rect(page, cx+3, cy+3, cx+cellWidth-4, cy+cellHeight-4, text);
+            }
+            //the thumbnails are only made once they're about to be seen
+            if (thumbs[i] == NULL) thumbs[i] = makethumb(m);
+            blit(thumbs[i], page, 0, 0, cx + (cellWidth - m->thumbw)/2, cy + 12 + (thumbSize - m->thumbh)/2, m->thumbw, m->thumbh);
+            textprintf_centre_ex(page, font, cx + cellWidth/2, cy + thumbSize + 24, text, -1, "%.18s", m->name);
+            textprintf_centre_ex(page, font, cx + cellWidth/2, cy + thumbSize + 40, text, -1, "%d x %d", m->width, m->height);
+            textprintf_centre_ex(page, font, cx + cellWidth/2, cy + thumbSize + 56, text, -1, "%ld walls%s", m->walls, m->spawnx == -1 ? ", no spawn" : "");
+        }
+        scare_mouse();
+        blit(page, screen, 0, 0, 0, 0, scrx, scry);
+        unscare_mouse();
+
+        waitevent(100);
+        bool pick = false;
+        while (keypressed()) {
+            int key = readkey();
+            switch ((key >> 8) & 0xFF) {
+            case KEY_LEFT:
+                if (selected > 0) selected--;
+                break;
+            case KEY_RIGHT:
+                if (selected < count-1) selected++;
+                break;
+            case KEY_UP:
+                if (selected >= pickerColumns) selected -= pickerColumns;
+                break;
+            case KEY_DOWN:
+                if (selected + pickerColumns < count) selected += pickerColumns;
+                else if (selected / pickerColumns < lastRow) selected = count-1;
+                break;
+            case KEY_PGUP:
+                selected -= pickerColumns*pickerRows;
+                if (selected < 0) selected = 0;
                 break;
-            } else if (scancode == KEY_ESC) {
-                strcpy(text, "quit");
+            case KEY_PGDN:
+                selected += pickerColumns*pickerRows;
+                if (selected > count-1) selected = count > 0 ? count-1 : 0;
+                break;
+            case KEY_ENTER:
+                pick = true;
+                break;
+            case KEY_ESC:
+                done = true;
                 break;
             }
         }
-        
-        if (quit) break;
-        if (strcmp(text, "quit")==0) {
-            text[0] = '\0';
-            break;
+
+        //the mouse wheel scrolls, taking the selection along with it
+        if (mouse_z != oldz) {
+            first -= mouse_z - oldz;
+            oldz = mouse_z;
+            if (first > lastRow - pickerRows + 1) first = lastRow - pickerRows + 1;
+            if (first < 0) first = 0;
+            int row = selected / pickerColumns;
+            if (row < first) selected += (first - row) * pickerColumns;
+            if (row >= first + pickerRows) selected -= (row - first - pickerRows + 1) * pickerColumns;
+            if (selected > count-1) selected = count > 0 ? count-1 : 0;
         }
-        
-        sprintf(tmp, "maps/%s", text);
 
-        if (!loadMap(tmp)) allegro_message("Could not find map.\nMake sure your map is in Serpens/map/\nTry again, or type \"quit\"");
-        else break;
-        
+        //clicking on a map picks it
+        if ((mouse_b & 1) && !clicked && mouse_y >= 40) {
+            int i = (first + (mouse_y - 40) / cellHeight) * pickerColumns + mouse_x / cellWidth;
+            if (i < count && mouse_x / cellWidth < pickerColumns) {
+                selected = i;
+                pick = true;
+            }
+        }
+        clicked = mouse_b & 1;
+
+        if (pick && count > 0 && !done) {
+            mapinfo *m = &mapIndex.maps[selected];
+            snprintf(path, PATH_MAX, "maps/%s", m->name);
+            if (loadMap(&world, path)) {
+                hstart(&world, path);
+                strcpy(out, m->name);
+                done = true;
+            } else snprintf(message, PATH_MAX, "Could not load %s, pick another map", m->name);
+        }
     }
+
+    //don't let the click that picked the map click on the menu as well
+    while ((mouse_b & 1) && !quit) waitevent(100);
+
     //clean up
-    destroy_bitmap(temp);
-    destroy_bitmap(prompt);
-    strcpy(out, text);
+    for (int i=0; i<count; i++) if (thumbs[i]) destroy_bitmap(thumbs[i]);
+    free(thumbs);
+    destroy_bitmap(page);
+}
+
+//starts a round, either from the start of the replay being watched or with a new seed that gets recorded
+void newround(engine *e, const char *lastFile, replay *playback) {
+    if (playback) {
+        clearturns();
+        rrewind(playback);
+        reset(e, playback->seed);
+        return;
+    }
+    clearturns();
+    uint64_t seed = ((uint64_t)rngnext(&seeds) << 32) | rngnext(&seeds);
+    rstart(&recording, lastFile, seed);
+    recordable = true;
+    reset(e, seed);
+}
+
+//keeps the game as it is now in memory, and in quickFile in case the game is closed
+void quicksaveto(engine *e) {
+    ecopy(&quick.state, e);
+    for (int i=0; i<3; i++) quick.color[i] = color[i];
+    strcpy(quick.map, recording.map);
+    quick.turns = recording.numTurns;
+    quick.saved = true;
+    if (!savesnapshot(quickFile, e, quick.map, quick.color)) printf("could not save %s\n", quickFile);
+}
+
+//goes back to the quick save, from memory if there is one or quickFile otherwise
+bool quickloadfrom(engine *e, char *lastFile) {
+    if (!quick.saved) {
+        if (!loadsnapshot(quickFile, &quick.state, quick.map, quick.color)) return false;
+        //there's no telling what turns led up to a save from another run
+        quick.turns = -1;
+        quick.saved = true;
+    }
+    if (!ecopy(e, &quick.state)) return false;
+    //the save could be on another map
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "maps/%s", quick.map);
+    hstart(e, path);
+
+    //the recording can carry on from the save if it's of the same game, otherwise it starts again
+    //from here, and won't be saved since it can't be played back from the start
+    if (quick.turns >= 0 && recording.seed == e->seed && strcmp(recording.map, quick.map) == 0 && recording.numTurns >= quick.turns) {
+        recording.numTurns = quick.turns;
+    } else {
+        rstart(&recording, quick.map, e->seed);
+        recordable = false;
+    }
+    strcpy(lastFile, quick.map);
+
+    //draw it all again, in its own colours
+    for (int i=0; i<3; i++) color[i] = quick.color[i];
+    makeatlas();
+    layout(e);
+    drawstatus(e);
+    clearturns();
+    pendingTicks = 0;
+    jitter.restart = true;
+    return true;
 }
 
-//the actual game
-void game(char *lastFile) {
+//the actual game, playback is the replay to watch, or NULL to play
+void game(char *lastFile, replay *playback) {
     //declare variables to be used
-    int posx, posy, velx, vely, foodx, foody, specx, specy, extend, numElem, score, bonusCounter=300;
-    float speed = 10;
-    bool changed, fancy=false;
-    snake* tail = NULL;
-    SAMPLE *eat = load_sample("bite.wav");
+    engine *e = &world;
+    int events, rate = 0;
+    bool dirty=true, over=false;
+    asset *eatAsset = useasset("bite.wav");
+    SAMPLE *eat = assetsample(eatAsset);
 
     //initialize values
-    reset(&foodx, &foody, &specx, &specy, &posx, &posy, &velx, &vely, &score, &extend, &tail, &speed, &numElem);
+    newround(e, lastFile, playback);
+    jitter = jitterstats();
+    jitter.restart = true;
+    latency = latencystats();
+    clearkeys();
+    install_int_ex(frameTimer, BPS_TO_TIMER(maxFPS));
+    pendingTicks = 0;
 
     //While the game isn't quitted
-    while (!key[KEY_ESC]&&!quit) {
-        
-        //decrease bonusCounter that is used for special foods
-        if (bonusCounter>50) bonusCounter--;
-        
-        //whether or not the direction changed
-        changed=false;
-        while (keypressed()) {
-            int key = readkey();
-            if ((key & 0xFF) == ' ') {
-                // paused
-                textprintf_centre_ex(screen, font, scrx / 2, 200, MSGCOL, -1, "GAME PAUSED");
-                while (true) {
-                    int k = readkey();
-                    if ((k & 0xFF) == ' ' || ((k >> 8) & 0xFF) == KEY_ESC) {
-                        break;
-                    }
-                }
-                continue;
-            }
+    while (!key[KEY_ESC]&&!quit&&!over) {
+        //the tick length follows the snake's speed, and replays can be sped up
+        int want = int(e->speed) * ((playback || demoing) && key[KEY_F] ? fastForward : 1);
+        if (rate != want) {
+            rate = want;
+            install_int_ex(tickTimer, BPS_TO_TIMER(rate));
+        }
 
-            if (changed) break;
-            switch ((key >> 8) & 0xFF) {
-            case KEY_DOWN:
-                if (vely == 0) {
-                    vely = 1;
-                    velx = 0;
-                    changed=true;
-                }
-                break;
-            case KEY_UP:
-                if (vely == 0) {
-                    vely = -1;
-                    velx = 0;
-                    changed=true;
-                }
-                break;
-            case KEY_RIGHT:
-                if (velx == 0) {
-                    velx = 1;
-                    vely = 0;
-                    changed=true;
+        //sleep until a tick is due, or a frame if there's something new to show. The timers wake
+        //this up, and so do keys, so escape is still seen straight away
+        while (pendingTicks == 0 && !(dirty && pendingFrames > 0) && !key[KEY_ESC] && !quit) waitwake(100);
+
+        //after a long stall, only make up for a few of the missed ticks
+        if (pendingTicks > maxCatchup) pendingTicks = maxCatchup;
+
+        while (pendingTicks > 0) {
+            pendingTicks--;
+
+            timeTick(rate);
+            perftick();
+            events = update(e, eat, lastFile, playback);
+            dirty = true;
+            if (events & (Died | Won)) {
+                //keep the game that just ended, so it can be watched again
+                if (!playback && recordable) {
+                    recording.length = e->tick;
+                    rsave(&recording, replayFile);
                 }
-                break;
-            case KEY_LEFT:
-                if (velx == 0) {
-                    velx = -1;
-                    vely = 0;
-                    changed=true;
+                //the board filling up is shown before the message goes over it
+                if (events & Won) present(screen);
+                if (demoing) {
+                    //the demo starts over by itself, it's meant to be left running
+                    textprintf_centre_ex(screen, font, scrx / 2, 200, msgcol, -1, "%s Final Score: %d", events & Won ? "Board Filled!" : "Demo Over!", e->score);
+                    rest(demoPause);
+                } else lose(e->score, events & Won);
+                if (playback) {
+                    over = true;
+                    break;
                 }
+                //start again, without rushing to make up for the time spent on the message
+                newround(e, lastFile, playback);
+                pendingTicks = 0;
+                jitter.restart = true;
                 break;
-            case KEY_M:
-                fancy=!fancy;
-                changed=true;
+            }
+            //a replay of a game that was quit before it ended just stops
+            if (playback && e->tick >= playback->length) {
+                over = true;
                 break;
             }
         }
-        
-        //handles movement
-        int prevx = posx, prevy = posy;
-        if (velx != 0 || vely != 0) {
-            snake *leftover = NULL;
-            
-            //if (snake isn't supposed to be growing in length this frame)
-            if (extend == 0) {
-                leftover = tail;
-                tail = leftover->next;
-                //draw over part to be deleted
-                rectfill(buffer, tail->x*20, tail->y*20, tail->x*20 + 19, tail->y*20 + 19, BACKCOL);
-                rectfill(buffer, leftover->x*20, leftover->y*20, leftover->x*20 + 19, leftover->y*20 + 19, BACKCOL);
-                //some variable declarations to make the next part easier
-                int dx = tail->next->x - tail->x;
-                int dy = tail->next->y - tail->y;
-                if (dx > 1) dx = -1;
-                else if (dx < -1) dx = 1;
-                if (dy > 1) dy = -1;
-                else if (dy < -1) dy = 1;
-                int hx = tail->x*20;
-                int hy = tail->y*20;
-
-                //fancy triangle tail
-                triangle(buffer, dx+dy==-1?hx:hx+19, dy+1==dx?hy:hy+19, dy+1==dx?hx+19:hx, dy+dx==-1?hy:hy+19, hx+9 - 9*dx, hy+9 - 9*dy, SNAKECOL);
-                
-                //remove from grid
-                grid[leftover->y][leftover->x] = map[leftover->y][leftover->x];
-            } else {
-                //decrease the length the snake should extend as the snake has just lengthened
-                --extend;
-                numElem++;
+
+        //draw, but no more often than maxFPS
+        if (dirty && pendingFrames > 0) {
+            perfbegin();
+            present(screen);
+            turnsshown();
+            perfmark(PhaseBlit);
+            perfframe();
+            dirty = false;
+            pendingFrames = 0;
+
+            //the overlay itself isn't timed, and isn't redrawn so often that it can't be read
+            std::chrono::duration<double, std::milli> shown = std::chrono::steady_clock::now() - overlayDrawn;
+            if (overlay && shown.count() >= overlayInterval) drawstatus(e);
+        }
+    }
+    //the last game's figures are saved with the frame times when the program closes
+    perfnote("tick_jitter_mean_ms", jitter.mean);
+    perfnote("tick_jitter_worst_ms", jitter.worst);
+    perfnote("input_latency_mean_ms", latency.mean);
+    perfnote("input_latency_worst_ms", latency.worst);
+
+    //a game that was quit part way through is still worth keeping
+    if (!playback && recordable && e->tick > 0) {
+        recording.length = e->tick;
+        rsave(&recording, replayFile);
+    }
+
+    //clean up
+    remove_int(tickTimer);
+    remove_int(frameTimer);
+    dropasset(eatAsset);
+}
+
+//plays back the last game that was recorded, on the map it was played on
+void watch(char *lastFile) {
+    replay r;
+    char path[PATH_MAX];
+    rinit(&r);
+    if (!rload(&r, replayFile)) {
+        allegro_message("There is no replay to watch.\nPlay a game first.");
+    } else {
+        snprintf(path, PATH_MAX, "maps/%s", r.map);
+        if (!loadMap(&world, path)) {
+            allegro_message("Could not find the replay's map, %s", r.map);
+        } else {
+            hstart(&world, path);
+            //the replay's map is loaded now, so play on it afterwards too
+            strcpy(lastFile, r.map);
+            game(lastFile, &r);
+        }
+    }
+    rdestroy(&r);
+}
+
+//the demo on the current map, until escape is pressed. The cycle is normally ready long before
+//this, having been started when the map was loaded, otherwise it's waited for
+void demo(char *lastFile) {
+    hamcycle *h;
+    while ((h = hready()) == NULL && !key[KEY_ESC] && !quit) {
+        textprintf_centre_ex(screen, font, scrx / 2, 300, makecol(255, 255, 255), makecol(0, 0, 0), "Finding a loop through %s, Esc to go back", lastFile);
+        rest(50);
+    }
+    if (h == NULL) {
+        clearkeys();
+        return;
+    }
+    if (h->status == CycleImpossible) {
+        allegro_message("%s has no loop through every square, so it can't have a demo:\n%s.", lastFile, h->reason);
+    } else if (h->status == CycleGaveUp) {
+        allegro_message("No loop through every square of %s could be found, so it can't have a demo:\n%s.", lastFile, h->reason);
+    } else {
+        demoing = true;
+        game(lastFile);
+        demoing = false;
+    }
+}
+
+//a game with more than one snake on the current map, until escape is pressed. Every round
+//goes on until there's only one snake left, or none if the last ones ran into each other
+void versus(int snakes) {
+    arena *a = &battle;
+    int directions[maxSnakes];
+    bool dirty = true, bots = false;
+    asset *eatAsset = useasset("bite.wav");
+    SAMPLE *eat = assetsample(eatAsset);
+
+    //the arena plays on whatever map was loaded last
+    if (!ecopy(&a->board, &world)) {
+        allegro_message("Not enough memory for an arena game.");
+        dropasset(eatAsset);
+        return;
+    }
+    uint64_t seed = ((uint64_t)rngnext(&seeds) << 32) | rngnext(&seeds);
+    pickcolors(seed);
+    if (!anewgame(a, snakes, seed)) {
+        allegro_message("There isn't room for %d snakes on this map.", snakes);
+        dropasset(eatAsset);
+        return;
+    }
+    layoutarena(a);
+    drawscores(a);
+    clearkeys();
+    install_int_ex(frameTimer, BPS_TO_TIMER(maxFPS));
+    install_int_ex(tickTimer, BPS_TO_TIMER(arenaSpeed));
+    pendingTicks = 0;
+
+    while (!key[KEY_ESC] && !quit) {
+        while (pendingTicks == 0 && !(dirty && pendingFrames > 0) && !key[KEY_ESC] && !quit) waitwake(100);
+        if (pendingTicks > maxCatchup) pendingTicks = maxCatchup;
+
+        while (pendingTicks > 0) {
+            pendingTicks--;
+            for (int p=0; p<snakes; p++) directions[p] = None;
+            while (keypressed()) {
+                int code = (readkey() >> 8) & 0xFF;
+                if (code == KEY_B) {
+                    bots = !bots;
+                } else if (code == KEY_M) {
+                    fancy = !fancy;
+                } else arenaturn(code, directions);
             }
-            
-            //move snake
-            posx += velx;
-            posy += vely;
-            
-            //wrap around the screen, if necessary
-            if (posx < 0) posx += gridWidth;
-            if (posx >= gridWidth) posx -= gridWidth;
-            if (posy < 0) posy += gridHeight;
-            if (posy >= gridHeight) posy -= gridHeight;
-            
-            //if snake gets food
-            if (grid[posy][posx] == Food) {
-                play_sample(eat, 255, 128, 1000, 0);
-                //replace food, redraw
-                placefood(&foodx, &foody, &specx, &specy);
-                circlefill(buffer, foodx*20+9, foody*20+9, 9, FOODCOL);
-                if (specx!=-1) {
-                    circlefill(buffer, specx*20+9, specy*20+9, 9, FOODCOL);
-                    circlefill(buffer, specx*20+9, specy*20+9, 6, SNAKECOL);
-                }
-                score += 10;
-                extend++;
-                if (speed>10) speed--;
-                rectfill(screen, 0, 600, 480, 640, BACKCOL);
-                textprintf_ex(screen, font, 0, 620, MSGCOL, -1, "Score: %d", score);
-
-            } else if (grid[posy][posx] == Special) {
-                play_sample(eat, 255, 128, 1000, 0);
-                specx=-1;
-                specy=-1;
-                score+=bonusCounter/10;
-                bonusCounter=300;
-                extend++;
-                if (speed>10) speed--;
-                rectfill(screen, 0, 600, 480, 640, BACKCOL);
-                textprintf_ex(screen, font, 0, 620, MSGCOL, -1, "Score: %d", score);
-            } else if (grid[posy][posx] == Snake) {
-                //lose the game
-
-                lose(score, color);
-                //destroy snake
-                while (tail != NULL) {
-                    snake *tmp = tail;
-                    tail = tail->next;
-                    free(tmp);
+            for (int p=0; p<snakes; p++) {
+                if (a->players[p].alive && (bots || p >= arenaHumans)) directions[p] = abot(a, p);
+            }
+
+            //every snake moves in one go
+            int events = astep(a, directions);
+            if (events & Ate) play_sample(eat, 255, 128, 1000, 0);
+            if (events & (Ate | Died)) drawscores(a);
+            drawarena(a);
+            dirty = true;
+
+            if (a->alive <= (snakes > 1 ? 1 : 0) || (events & Won)) {
+                present(screen);
+                int winner = -1;
+                for (int p=0; p<snakes; p++) {
+                    if (a->players[p].alive) winner = p;
                 }
-                //start again
-                reset(&foodx, &foody, &specx, &specy, &posx, &posy, &velx, &vely, &score, &extend, &tail, &speed, &numElem);
-                continue;
+                if (winner == -1) textprintf_centre_ex(screen, font, scrx / 2, 200, msgcol, -1, "Nobody Wins!");
+                else textprintf_centre_ex(screen, font, scrx / 2, 200, playercol[winner], -1, "Player %d Wins!", winner + 1);
+                textprintf_centre_ex(screen, font, scrx / 2, 250, msgcol, -1, "Press Space to Play Again");
+                int k;
+                do k = waitkey();
+                while ((k & 0xFF) != ' ' && ((k >> 8) & 0xFF) != KEY_ESC);
+                if (((k >> 8) & 0xFF) == KEY_ESC) break;
+
+                seed = ((uint64_t)rngnext(&seeds) << 32) | rngnext(&seeds);
+                pickcolors(seed);
+                anewgame(a, snakes, seed);
+                layoutarena(a);
+                drawscores(a);
+                clearkeys();
+                pendingTicks = 0;
+                break;
             }
-            //add to the beginning of the snake
-            sappend(&tail, posx, posy, leftover);
-            grid[posy][posx] = Snake;
         }
 
-        //draw the snake's head
-        circlefill(buffer, posx*20+9, posy*20+9, 9, SNAKECOL);
+        if (dirty && pendingFrames > 0) {
+            present(screen);
+            dirty = false;
+            pendingFrames = 0;
+        }
+    }
 
-        //ensure the body looks good
-        if (velx) {
-            int x = posx * 20 + ((velx == -1) ? 10 : 0);
-            rectfill(buffer, x, posy * 20, x + 9, posy * 20 + 19, SNAKECOL);
-            x = prevx * 20 + ((velx == 1) ? 10 : 0);
-            rectfill(buffer, x, posy * 20, x + 9, posy * 20 + 19, SNAKECOL);
+    remove_int(tickTimer);
+    remove_int(frameTimer);
+    dropasset(eatAsset);
+}
+
+//steers the snakes played from the keyboard, the first turn each one is given in a tick counts
+bool arenaturn(int code, int *directions) {
+    static const int keys[arenaHumans][4] = {
+        {KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT},
+        {KEY_W, KEY_S, KEY_A, KEY_D}
+    };
+    for (int p=0; p<arenaHumans && p<battle.numPlayers; p++)
+        for (int i=0; i<4; i++) {
+            if (keys[p][i] != code) continue;
+            if (directions[p] == None && acanturn(&battle.players[p], Up + i)) directions[p] = Up + i;
+            return true;
         }
-        if (vely) {
-            int y = posy * 20 + ((vely == -1) ? 10 : 0);
-            rectfill(buffer, posx * 20, y-2, posx * 20 + 19, y + 9, SNAKECOL);
-            y = prevy * 20 + ((vely == 1) ? 10 : 0);
-            rectfill(buffer, posx * 20, y-2, posx * 20 + 19, y + 9, SNAKECOL);
+    return false;
+}
+
+//the bar under the map in an arena game, every snake's score in its own colour, crossed out once it's dead
+void drawscores(arena *a) {
+    rectfill(screen, 0, 600, 480, 640, backcol);
+    for (int p=0; p<a->numPlayers; p++) {
+        int x = (p % 4) * (scrx / 4) + 4, y = p < 4 ? 608 : 624;
+        textprintf_ex(screen, font, x, y, playercol[p], -1, "P%d: %d", p + 1, a->players[p].score);
+        if (!a->players[p].alive) hline(screen, x, y + 3, x + text_length(font, "P0: 000"), playercol[p]);
+    }
+}
+
+//records when a tick actually ran, to keep track of how evenly spaced the ticks really are
+void timeTick(int rate) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!jitter.restart) {
+        std::chrono::duration<double, std::milli> interval = now - jitter.lastTick;
+        jitter.last = fabs(interval.count() - 1000.0/rate);
+        jitter.count++;
+        jitter.mean += (jitter.last - jitter.mean) / jitter.count;
+        if (jitter.last > jitter.worst) jitter.worst = jitter.last;
+    }
+    jitter.restart = false;
+    jitter.lastTick = now;
+}
+
+//the direction the snake is going in, None before it starts moving
+int heading(engine *e) {
+    if (e->velx) return e->velx > 0 ? Right : Left;
+    if (e->vely) return e->vely > 0 ? Down : Up;
+    return None;
+}
+
+//adds a turn to the end of the queue. It's checked against the turn before it in the queue, or
+//the way the snake is going if there isn't one, so it can't reverse into itself or repeat a turn
+void queueturn(engine *e, int direction, std::chrono::steady_clock::time_point when) {
+    int last = turns.length > 0 ? turns.directions[(turns.start + turns.length - 1) % maxQueued] : heading(e);
+    bool vertical = direction == Up || direction == Down;
+    if (last != None && vertical == (last == Up || last == Down)) return;
+    //too many turns waiting, the player is mashing keys
+    if (turns.length == maxQueued) return;
+    int i = (turns.start + turns.length++) % maxQueued;
+    turns.directions[i] = direction;
+    turns.pressed[i] = when;
+}
+
+//forgets the turns waiting to be made, and any that haven't been shown yet
+void clearturns() {
+    turns.start = turns.length = 0;
+    latency.numUnshown = 0;
+}
+
+//called when buffer has just been shown, so every turn that was made is on the screen now
+void turnsshown() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (int i=0; i<latency.numUnshown; i++) {
+        std::chrono::duration<double, std::milli> elapsed = now - latency.unshown[i];
+        latency.count++;
+        latency.mean += (elapsed.count() - latency.mean) / latency.count;
+        if (elapsed.count() > latency.worst) latency.worst = elapsed.count();
+    }
+    latency.numUnshown = 0;
+}
+
+//runs one tick of the game: reads the keyboard (or the replay), moves the snake and draws the changes into buffer
+int update(engine *e, SAMPLE *eat, char *lastFile, replay *playback) {
+    TRACE("update");
+    int direction, events;
+    std::chrono::steady_clock::time_point when;
+
+    //every key gets read, turns go in the queue so none are lost when they come quicker than the ticks
+    perfbegin();
+    direction=None;
+    while (keypressed()) {
+        int key = readkeytime(&when);
+        if ((key & 0xFF) == ' ') {
+            // paused
+            textprintf_centre_ex(screen, font, scrx / 2, 200, msgcol, -1, "GAME PAUSED");
+            while (true) {
+                int k = waitkey();
+                if ((k & 0xFF) == ' ' || ((k >> 8) & 0xFF) == KEY_ESC) {
+                    break;
+                }
+            }
+            //don't try to make up for the time spent paused, or count it as input lag, and clear the message
+            pendingTicks = 0;
+            jitter.restart = true;
+            clearturns();
+            clearkeys();
+            markall();
+            perfbegin();
+            break;
         }
 
-        //if fancy centred mode is on, then show it as such
-        if (fancy) {
-            blit(buffer, screen, 0, 0, scrx/2 - posx*20, (scry-40)/2 - posy*20, buffer->w, buffer->h-((scry-40)/2 - posy*20));
-            blit(buffer, screen, 0, 0, scrx/2 - posx*20 - (scrx/2>posx*20?scrx:-scrx), (scry-40)/2 - posy*20, buffer->w, buffer->h-((scry-40)/2 - posy*20));
-            blit(buffer, screen, 0, 0, scrx/2 - posx*20, (scry-40)/2 - posy*20 - ((scry-40)/2>posy*20?scry-40:-scry+40), buffer->w, buffer->h-((scry-40)/2 - posy*20 - ((scry-40)/2>posy*20?scry-40:-scry+40)));
-            blit(buffer, screen, 0, 0, scrx/2 - posx*20 - (scrx/2>posx*20?scrx:-scrx), (scry-40)/2 - posy*20 - ((scry-40)/2>posy*20?scry-40:-scry+40), buffer->w, buffer->h-((scry-40)/2 - posy*20 - ((scry-40)/2>posy*20?scry-40:-scry+40)));
+        switch ((key >> 8) & 0xFF) {
+        case KEY_DOWN:
+            queueturn(e, Down, when);
+            break;
+        case KEY_UP:
+            queueturn(e, Up, when);
+            break;
+        case KEY_RIGHT:
+            queueturn(e, Right, when);
+            break;
+        case KEY_LEFT:
+            queueturn(e, Left, when);
+            break;
+        case KEY_M:
+            fancy=!fancy;
+            break;
+        case KEY_A:
+            autopilot=!autopilot;
+            drawstatus(e);
+            break;
+        case KEY_P:
+            overlay=!overlay;
+            drawstatus(e);
+            break;
+        case KEY_F5:
+            if (!playback && !demoing) quicksaveto(e);
+            break;
+        case KEY_F9:
+            //the loaded game starts on the next tick, the demo can't carry on from somewhere else
+            if (!playback && !demoing && quickloadfrom(e, lastFile)) return 0;
+            break;
+        case KEY_T:
+            if (!tracedump(traceFile)) printf("could not save %s, is tracing built in?\n", traceFile);
+            break;
         }
-        else blit(buffer, screen, 0, 0, 0, 0, buffer->w, buffer->h);
+    }
+    perfmark(PhaseInput);
 
-        rest(int(1000/speed));
+    //make the oldest turn that's waiting, the rest carry over to the next ticks
+    if (turns.length > 0) {
+        direction = turns.directions[turns.start];
+        when = turns.pressed[turns.start];
+        turns.start = (turns.start + 1) % maxQueued;
+        turns.length--;
+        if (!canturn(e, direction)) direction = None;
+        else if (!autopilot && !playback && latency.numUnshown < maxQueued) latency.unshown[latency.numUnshown++] = when;
     }
-    //clean up
-    while (tail != NULL) {
-        snake *tmp = tail;
-        tail = tail->next;
-        free(tmp);
+
+    //the autopilot steers instead of the keyboard, but not when watching a replay
+    if (autopilot && !playback) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        direction = steer(&pilot, e);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        searchTime = elapsed.count();
+        if (!canturn(e, direction)) direction = None;
     }
-    destroy_sample(eat);
+
+    //and the demo steers instead of both
+    if (demoing && hready()) {
+        direction = hsteer(hready(), e);
+        if (!canturn(e, direction)) direction = None;
+    }
+
+    //a replay steers by itself, otherwise remember the turn so this game can be replayed
+    if (playback) direction = rdirection(playback, e->tick);
+    else if (direction != None) rrecord(&recording, e->tick, direction);
+    
+    //handles movement
+    events = step(e, direction);
+    perfmark(PhaseLogic);
+
+    //the caller handles losing the game
+    if (events & Died) return events;
+
+    if (events & (Ate | AteSpecial)) {
+        play_sample(eat, 255, 128, 1000, 0);
+        drawstatus(e);
+    } else if (autopilot) drawstatus(e);
+
+    drawevents(e, events);
+    perfmark(PhaseRender);
+    return events;
+}
+
+//draws the bar under the map, with the score and how long the autopilot is taking
+//the overlay squeezes in how fast the game is running and where the time goes as well
+void drawstatus(engine *e) {
+    int y = overlay ? 603 : 620;
+    rectfill(screen, 0, 600, 480, 640, backcol);
+    textprintf_ex(screen, font, 0, y, msgcol, -1, "Score: %d", e->score);
+    if (demoing && hready()) textprintf_right_ex(screen, font, scrx, y, msgcol, -1, "Demo (loop %s): hold F to speed up", hready()->reason);
+    else if (autopilot) textprintf_right_ex(screen, font, scrx, y, msgcol, -1, "Autopilot: %.3f ms", searchTime);
+    if (!overlay) return;
+
+    perfsummary s;
+    perfsummarize(&s);
+    textprintf_ex(screen, font, 0, 612, msgcol, -1, "%.1f ticks/s  %.1f fps  length %d  jitter %.2f ms", s.ticksPerSecond, s.framesPerSecond, e->body.length, jitter.mean);
+    textprintf_ex(screen, font, 0, 621, msgcol, -1, "frame p50 %.3f ms  p99 %.3f ms  input %.1f ms", s.p50, s.p99, latency.mean);
+    textprintf_ex(screen, font, 0, 630, msgcol, -1, "in %.3f  logic %.3f  draw %.3f  blit %.3f ms  cpu %.0f%%",
+                  s.phase[PhaseInput], s.phase[PhaseLogic], s.phase[PhaseRender], s.phase[PhaseBlit], cpuusage());
+    overlayDrawn = std::chrono::steady_clock::now();
 }
 
 
 void menu() {
     //declare and initialize
-    BITMAP *menu = load_bitmap("controls.bmp", NULL);
-    BITMAP *play = load_bitmap("play.bmp", NULL);
-    BITMAP *map = load_bitmap("map.bmp", NULL);
+    asset *menuAsset = useasset("controls.bmp");
+    asset *playAsset = useasset("play.bmp");
+    asset *mapAsset = useasset("map.bmp");
+    asset *buttonAsset = useasset("button.wav");
+    asset *music = useasset("tetris.mid");
+    BITMAP *menu = assetbitmap(menuAsset);
     bool clicked=false;
     int selection = 0;
-    char lastFile[30]="default.txt";
-    char temp[30];
-    SAMPLE *button = load_sample("button.wav");
+    char lastFile[maxMapName+1]="default.txt";
+    char temp[maxMapName+1];
     
     //show mouse
     if (show_os_cursor(MOUSE_CURSOR_ARROW) != 0) {
@@ -517,9 +957,18 @@ void menu() {
     }
     //draw menu screen
     blit(menu, screen, 0, 0, 0, 0, 480, 640 );
+    std::chrono::duration<double, std::milli> startup = std::chrono::steady_clock::now() - launched;
+    perfnote("startup_ms", startup.count());
+
+    //the rest can be waited for now that there's something on the screen
+    BITMAP *play = assetbitmap(playAsset);
+    BITMAP *map = assetbitmap(mapAsset);
+    SAMPLE *button = assetsample(buttonAsset);
+
+    //play bg music
+    play_midi(assetmidi(music), 1);
     
     while (!quit) {
-		rest(20);
         while (keypressed()) {
             int key = readkey();
             switch ((key >> 8) & 0xFF) {
@@ -534,6 +983,18 @@ void menu() {
             case KEY_ESC:
                 quit=1;
                 break;
+            case KEY_R:
+                watch(lastFile);
+                blit(menu, screen, 0, 0, 0, 0, 480, 640 );
+                break;
+            case KEY_D:
+                demo(lastFile);
+                blit(menu, screen, 0, 0, 0, 0, 480, 640 );
+                break;
+            case KEY_2: case KEY_3: case KEY_4: case KEY_5: case KEY_6: case KEY_7: case KEY_8:
+                versus(((key >> 8) & 0xFF) - KEY_0);
+                blit(menu, screen, 0, 0, 0, 0, 480, 640 );
+                break;
             }
         }
         
@@ -567,6 +1028,7 @@ void menu() {
                     selection = 0;
                     blit(menu, screen, 0, 0, 0, 0, 480, 640 );
                 }
+                waitevent(100);
             }
             if (!selection) blit(menu, screen, 0, 0, 0, 0, 480, 640);
         }
@@ -603,20 +1065,19 @@ void menu() {
                     selection = 0;
                     blit(menu, screen, 0, 0, 0, 0, 480, 640);
                 }
+                waitevent(100);
             }
             if (!selection) blit(menu, screen, 0, 0, 0, 0, 480, 640 );
         }
-        rest(50);
+        //sleep until the mouse moves or a key is pressed
+        waitevent(100);
     }
     //clean up
-    destroy_bitmap(menu);
-    destroy_bitmap(play);
-    destroy_bitmap(map);
+    dropasset(menuAsset);
+    dropasset(playAsset);
+    dropasset(mapAsset);
+    dropasset(buttonAsset);
+    dropasset(music);
+    assetreport();
 }
 
-
-
-
-
-
-
@@ -0,0 +1,73 @@
+/* Eddy Gao                     Serpens - Snake body                         ICS3U
+The snake's body is kept in a ring buffer that is allocated once, big enough to
+hold every square of the grid. Adding a new head and removing the tail are both
+constant time, and nothing is allocated while the game is being played.
+*/
+#ifndef SNAKE_H
+#define SNAKE_H
+
+#include <stdlib.h>
+
+//structure to store a snake segment
+typedef struct segment {
+    int x;
+    int y;
+} segment;
+
+//the whole snake, stored oldest segment (the tail) first
+typedef struct snake {
+    segment *cells;
+    int capacity;
+    int start;  //index of the tail in cells
+    int length;
+} snake;
+
+//allocates room for a snake that is at most capacity segments long
+inline bool sinit(snake *L, int capacity) {
+    L->cells = (segment*)malloc(sizeof(segment) * capacity);
+    L->capacity = L->cells != NULL ? capacity : 0;
+    L->start = 0;
+    L->length = 0;
+    return L->cells != NULL;
+}
+
+inline void sdestroy(snake *L) {
+    free(L->cells);
+    L->cells = NULL;
+    L->capacity = L->start = L->length = 0;
+}
+
+//removes every segment, but keeps the memory around for the next game
+inline void sclear(snake *L) {
+    L->start = 0;
+    L->length = 0;
+}
+
+//gets the i-th segment counting from the tail, so 0 is the tail and length-1 is the head
+inline segment *getElem(snake *L, int i) {
+    i += L->start;
+    if (i >= L->capacity) i -= L->capacity;
+    return &L->cells[i];
+}
+
+inline segment *shead(snake *L) {
+    return getElem(L, L->length - 1);
+}
+
+//appends a snake element to the end of the buffer, or the beginning of the snake
+inline void sappend(snake *L, int x, int y) {
+    segment *s = getElem(L, L->length);
+    s->x = x;
+    s->y = y;
+    L->length++;
+}
+
+//removes the tail and returns it
+inline segment spop(snake *L) {
+    segment s = L->cells[L->start];
+    if (++L->start == L->capacity) L->start = 0;
+    L->length--;
+    return s;
+}
+
+#endif
@@ -0,0 +1,272 @@
+/* Eddy Gao                     Serpens - Snapshots                          ICS3U
+Saving and loading snapshots. See snapshot.h.
+
+Snapshot files are laid out like this, every number is little endian:
+    "SSAV"              magic
+    version             always 1, 32 bits
+    name length         one byte, followed by the map's name
+    colour              3 bytes, red, green and blue
+    width, height, spawnx, spawny, posx, posy, velx, vely, foodx, foody,
+    specx, specy, extend, score, bonusCounter, tick, leftover x and y,
+    speed               32 bits each, speed is the bits of the float
+    seed, rng state, rng increment
+                        64 bits each
+    map                 the starting map, packed the same way as in the engine
+                        (16 squares to a 64 bit word, stride words a row)
+    body length         32 bits, then the tail's x and y
+    body                2 bits for every other segment, the direction (minus one)
+                        from the segment before it, 4 to a byte, lowest bits first
+    free squares        32 bits for how many, then each square (y*width + x) in the
+                        order the engine keeps them, since that decides where food goes
+The grid isn't saved, it's the map with the snake and the food put on it.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+//the snapshot is put together in memory and written in one go
+typedef struct bytes {
+    unsigned char *data;
+    long size, capacity, read;
+    bool ok;    //false once something didn't fit, or a read went past the end
+} bytes;
+
+static void put(bytes *b, const void *data, long n) {
+    if (!b->ok) return;
+    if (b->size + n > b->capacity) {
+        long capacity = b->capacity ? b->capacity : 4096;
+        while (capacity < b->size + n) capacity *= 2;
+        unsigned char *more = (unsigned char*)realloc(b->data, capacity);
+        if (more == NULL) {
+            b->ok = false;
+            return;
+        }
+        b->data = more;
+        b->capacity = capacity;
+    }
+    memcpy(b->data + b->size, data, n);
+    b->size += n;
+}
+
+static void put8(bytes *b, int n) {
+    unsigned char c = (unsigned char)n;
+    put(b, &c, 1);
+}
+
+static void put32(bytes *b, uint32_t n) {
+    unsigned char c[4] = {(unsigned char)n, (unsigned char)(n >> 8), (unsigned char)(n >> 16), (unsigned char)(n >> 24)};
+    put(b, c, 4);
+}
+
+static void put64(bytes *b, uint64_t n) {
+    put32(b, (uint32_t)n);
+    put32(b, (uint32_t)(n >> 32));
+}
+
+static const unsigned char *get(bytes *b, long n) {
+    if (!b->ok || n > b->size - b->read) {
+        b->ok = false;
+        return NULL;
+    }
+    b->read += n;
+    return b->data + b->read - n;
+}
+
+static int get8(bytes *b) {
+    const unsigned char *c = get(b, 1);
+    return c ? c[0] : 0;
+}
+
+static uint32_t get32(bytes *b) {
+    const unsigned char *c = get(b, 4);
+    return c ? c[0] | (c[1] << 8) | (c[2] << 16) | ((uint32_t)c[3] << 24) : 0;
+}
+
+static uint64_t get64(bytes *b) {
+    uint64_t low = get32(b);
+    return low | ((uint64_t)get32(b) << 32);
+}
+
+//the direction (minus one) that goes from a to b, or -1 if they aren't next to each other
+static int towards(engine *e, segment *a, segment *b) {
+    int up = a->y > 0 ? a->y - 1 : e->height - 1, down = a->y < e->height - 1 ? a->y + 1 : 0;
+    int left = a->x > 0 ? a->x - 1 : e->width - 1, right = a->x < e->width - 1 ? a->x + 1 : 0;
+    if (b->x == a->x && b->y == up) return Up - 1;
+    if (b->x == a->x && b->y == down) return Down - 1;
+    if (b->y == a->y && b->x == left) return Left - 1;
+    if (b->y == a->y && b->x == right) return Right - 1;
+    return -1;
+}
+
+bool savesnapshot(const char *path, engine *e, const char *map, const int color[3]) {
+    bytes b = {NULL, 0, 0, 0, true};
+    int name = strlen(map) < (size_t)maxSnapshotName ? strlen(map) : maxSnapshotName;
+    uint32_t speed;
+    memcpy(&speed, &e->speed, 4);
+
+    put(&b, "SSAV", 4);
+    put32(&b, 1);
+    put8(&b, name);
+    put(&b, map, name);
+    for (int i=0; i<3; i++) put8(&b, color[i]);
+    int values[] = {e->width, e->height, e->spawnx, e->spawny, e->posx, e->posy, e->velx, e->vely, e->foodx, e->foody,
+                    e->specx, e->specy, e->extend, e->score, e->bonusCounter, e->tick, e->leftover.x, e->leftover.y};
+    for (int i=0; i<18; i++) put32(&b, values[i]);
+    put32(&b, speed);
+    put64(&b, e->seed);
+    put64(&b, e->random.state);
+    put64(&b, e->random.inc);
+    for (long i=0; i<(long)e->stride * e->height; i++) put64(&b, e->map[i]);
+
+    put32(&b, e->body.length);
+    if (e->body.length > 0) {
+        put32(&b, getElem(&e->body, 0)->x);
+        put32(&b, getElem(&e->body, 0)->y);
+    }
+    int packed = 0;
+    for (int i=1; i<e->body.length; i++) {
+        int direction = towards(e, getElem(&e->body, i-1), getElem(&e->body, i));
+        if (direction < 0) {
+            free(b.data);
+            return false;
+        }
+        packed |= direction << ((i-1) % 4 * 2);
+        if ((i-1) % 4 == 3 || i == e->body.length - 1) {
+            put8(&b, packed);
+            packed = 0;
+        }
+    }
+
+    put32(&b, e->numFree);
+    for (int i=0; i<e->numFree; i++) put32(&b, e->freeCells[i]);
+
+    FILE *f = b.ok ? fopen(path, "wb") : NULL;
+    bool ok = f != NULL && fwrite(b.data, 1, b.size, f) == (size_t)b.size;
+    if (f != NULL && fclose(f) != 0) ok = false;
+    free(b.data);
+    return ok;
+}
+
+//reads the rest of a snapshot into t, which has to be the right size already
+static bool parsesnapshot(bytes *b, engine *t) {
+    long words = (long)t->stride * t->height, squares = (long)t->width * t->height;
+    t->spawnx = get32(b);
+    t->spawny = get32(b);
+    t->posx = get32(b);
+    t->posy = get32(b);
+    t->velx = get32(b);
+    t->vely = get32(b);
+    t->foodx = get32(b);
+    t->foody = get32(b);
+    t->specx = get32(b);
+    t->specy = get32(b);
+    t->extend = get32(b);
+    t->score = get32(b);
+    t->bonusCounter = get32(b);
+    t->tick = get32(b);
+    t->leftover.x = get32(b);
+    t->leftover.y = get32(b);
+    uint32_t speed = get32(b);
+    memcpy(&t->speed, &speed, 4);
+    t->seed = get64(b);
+    t->random.state = get64(b);
+    t->random.inc = get64(b);
+    for (long i=0; i<words; i++) t->map[i] = get64(b);
+    memcpy(t->grid, t->map, sizeof(uint64_t) * words);
+    if (!b->ok || t->posx < 0 || t->posy < 0 || t->posx >= t->width || t->posy >= t->height) return false;
+    if (t->velx < -1 || t->velx > 1 || t->vely < -1 || t->vely > 1) return false;
+
+    //put the snake back on the grid, a step at a time from the tail
+    int length = get32(b);
+    if (length < 0 || length > squares) return false;
+    segment s = {0, 0};
+    if (length > 0) {
+        s.x = get32(b);
+        s.y = get32(b);
+    }
+    const unsigned char *packed = get(b, (length + 2) / 4);
+    if (!b->ok || s.x < 0 || s.y < 0 || s.x >= t->width || s.y >= t->height) return false;
+    for (int i=0; i<length; i++) {
+        if (i > 0) {
+            int direction = ((packed[(i-1) / 4] >> ((i-1) % 4 * 2)) & 3) + 1;
+            s.x += (direction == Right) - (direction == Left);
+            s.y += (direction == Down) - (direction == Up);
+            if (s.x < 0) s.x += t->width;
+            if (s.x >= t->width) s.x -= t->width;
+            if (s.y < 0) s.y += t->height;
+            if (s.y >= t->height) s.y -= t->height;
+        }
+        sappend(&t->body, s.x, s.y);
+        setsquare(t->grid, t->stride, s.x, s.y, Snake);
+    }
+
+    //the food has to be on the map, the special food can be missing
+    if (t->foodx != -1) {
+        if (t->foodx < 0 || t->foody < 0 || t->foodx >= t->width || t->foody >= t->height) return false;
+        setsquare(t->grid, t->stride, t->foodx, t->foody, Food);
+    }
+    if (t->specx != -1) {
+        if (t->specx < 0 || t->specy < 0 || t->specx >= t->width || t->specy >= t->height) return false;
+        setsquare(t->grid, t->stride, t->specx, t->specy, Special);
+    }
+
+    //the free squares have to be exactly the empty ones, each listed once
+    t->numFree = get32(b);
+    if (!b->ok || t->numFree < 0 || t->numFree > squares) return false;
+    for (long c=0; c<squares; c++) t->freeIndex[c] = -1;
+    for (int i=0; i<t->numFree; i++) {
+        uint32_t c = get32(b);
+        if (!b->ok || c >= (uint32_t)squares || t->freeIndex[c] != -1) return false;
+        if (getgrid(t, c % t->width, c / t->width) != Empty) return false;
+        t->freeCells[i] = c;
+        t->freeIndex[c] = i;
+    }
+    int empty = 0;
+    for (int y=0; y<t->height; y++)
+        for (int x=0; x<t->width; x++) empty += getgrid(t, x, y) == Empty;
+    return empty == t->numFree && b->read == b->size;
+}
+
+//loads a snapshot into e, which is left alone if the file isn't a good snapshot.
+//map gets the map's name and needs room for maxSnapshotName+1 characters
+bool loadsnapshot(const char *path, engine *e, char *map, int color[3]) {
+    bytes b = {NULL, 0, 0, 0, true};
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+    fseek(f, 0, SEEK_END);
+    b.size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    b.data = (unsigned char*)malloc(b.size > 0 ? b.size : 1);
+    b.ok = b.data != NULL && fread(b.data, 1, b.size, f) == (size_t)b.size;
+    fclose(f);
+
+    const unsigned char *magic = get(&b, 4);
+    if (!b.ok || memcmp(magic, "SSAV", 4) != 0 || get32(&b) != 1) {
+        free(b.data);
+        return false;
+    }
+    char name[maxSnapshotName + 1];
+    int length = get8(&b);
+    const unsigned char *text = get(&b, length);
+    int colors[3];
+    for (int i=0; i<3; i++) colors[i] = get8(&b);
+    long width = get32(&b), height = get32(&b);
+    //the map alone takes half a byte a square, so a bad size can't ask for lots of memory
+    if (!b.ok || width < 1 || height < 1 || width > b.size * 2 || height > b.size * 2 || (uint64_t)width * height > (uint64_t)b.size * 2) {
+        free(b.data);
+        return false;
+    }
+    memcpy(name, text, length);
+    name[length] = '\0';
+
+    //read it into an engine of its own first, so e is only changed if all of it is good
+    engine t;
+    bool ok = einit(&t) && setsize(&t, width, height) && parsesnapshot(&b, &t) && ecopy(e, &t);
+    edestroy(&t);
+    free(b.data);
+    if (!ok) return false;
+    strcpy(map, name);
+    for (int i=0; i<3; i++) color[i] = colors[i];
+    return true;
+}
@@ -0,0 +1,21 @@
+/* Eddy Gao                     Serpens - Snapshots                          ICS3U
+Saving a game part way through and picking it up again later. A snapshot is
+everything in the engine (the map, the snake, the food, the counters and the
+state of the random number generator) along with the things only the game knows
+about, the map's name and the colour scheme. A game carried on from a snapshot
+plays out exactly like the original would have from the same point.
+To keep a position in memory, for quick saves or bots trying out moves, just copy
+the engine with ecopy(). These are for keeping one in a file.
+*/
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "engine.h"
+
+//longest map name a snapshot will store
+const int maxSnapshotName = 255;
+
+bool savesnapshot(const char *path, engine *e, const char *map, const int color[3]);
+bool loadsnapshot(const char *path, engine *e, char *map, int color[3]);
+
+#endif
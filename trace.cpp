@@ -0,0 +1,107 @@
+/* Eddy Gao                     Serpens - Tracing                            ICS3U
+The per-thread trace buffers. See trace.h. Anything built with this file has tracing,
+even if SERPENS_TRACE is only defined for some of it, like bench.cpp does.
+*/
+#ifndef SERPENS_TRACE
+#define SERPENS_TRACE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include "trace.h"
+
+thread_local tracebuffer *tracemine = NULL;
+
+//every thread's buffer, they are kept after the thread ends so its scopes still get saved
+static std::mutex lock;
+static tracebuffer **buffers = NULL;
+static int numBuffers = 0;
+
+//what each name number stands for, 0 is kept for the names that didn't fit
+static const char *names[traceNames] = {"other"};
+static int numNames = 1;
+
+//a time from tracenow() and the clock at the same moment, to work out how fast tracenow() goes
+static uint64_t startTicks = tracenow();
+static std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+//makes a buffer for the thread the first time it records anything
+tracebuffer *traceaddbuffer() {
+    tracebuffer *b = (tracebuffer*)calloc(1, sizeof(tracebuffer));
+    if (b == NULL) return NULL;
+    std::lock_guard<std::mutex> hold(lock);
+    tracebuffer **more = (tracebuffer**)realloc(buffers, sizeof(tracebuffer*) * (numBuffers + 1));
+    if (more == NULL) {
+        free(b);
+        return NULL;
+    }
+    buffers = more;
+    buffers[numBuffers++] = b;
+    tracemine = b;
+    return b;
+}
+
+uint16_t tracename(const char *name) {
+    std::lock_guard<std::mutex> hold(lock);
+    for (int i=1; i<numNames; i++) {
+        if (strcmp(names[i], name) == 0) return i;
+    }
+    if (numNames == traceNames) return 0;
+    names[numNames] = name;
+    return numNames++;
+}
+
+//puts a scope's whole times back together from the halves that were recorded
+static uint64_t eventstart(const traceevent *e) {
+    return (uint64_t)(e->high - e->span) << 32 | e->start;
+}
+
+static uint64_t eventend(const traceevent *e) {
+    return (uint64_t)e->high << 32 | e->end;
+}
+
+//saves every thread's scopes as complete ("X") events, times are in microseconds from the earliest one.
+//Threads can keep recording while this runs, the scopes they write over are just left out
+bool tracedump(const char *path) {
+    std::lock_guard<std::mutex> hold(lock);
+    uint64_t first = UINT64_MAX;
+    unsigned *ends = (unsigned*)malloc(sizeof(unsigned) * (numBuffers + 1));
+    if (ends == NULL) return false;
+    for (int t=0; t<numBuffers; t++) {
+        ends[t] = buffers[t]->written.load(std::memory_order_acquire);
+        unsigned start = ends[t] > (unsigned)traceCapacity ? ends[t] - traceCapacity : 0;
+        for (unsigned i=start; i<ends[t]; i++) {
+            uint64_t s = eventstart(&buffers[t]->events[i % traceCapacity]);
+            if (s < first) first = s;
+        }
+    }
+
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        free(ends);
+        return false;
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+    double ticksPerMicro = (tracenow() - startTicks) / elapsed.count();
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    bool comma = false;
+    for (int t=0; t<numBuffers; t++) {
+        unsigned start = ends[t] > (unsigned)traceCapacity ? ends[t] - traceCapacity : 0;
+        for (unsigned i=start; i<ends[t]; i++) {
+            traceevent e = buffers[t]->events[i % traceCapacity];
+            //skip the scope if the thread has got round to writing over it, or might be now
+            std::atomic_thread_fence(std::memory_order_acquire);
+            unsigned now = buffers[t]->written.load(std::memory_order_relaxed);
+            if (now - i >= (unsigned)traceCapacity) continue;
+            uint64_t s = eventstart(&e);
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    comma ? ",\n" : "", names[e.name], t + 1, (s - first) / ticksPerMicro, (eventend(&e) - s) / ticksPerMicro);
+            comma = true;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    free(ends);
+    return fclose(f) == 0;
+}
@@ -0,0 +1,92 @@
+/* Eddy Gao                     Serpens - Tracing                            ICS3U
+Scope timers for finding out where the time goes without a profiler. Putting
+    TRACE("name");
+at the top of a block times everything from there to the end of the block. Every
+thread records into its own buffer, which keeps the last traceCapacity scopes, and
+tracedump() saves all of them in the trace event format that chrome://tracing and
+Perfetto open. A scope costs little more than reading the cycle counter twice,
+bench.cpp measures it as trace_ns_per_scope.
+Tracing is only compiled in when SERPENS_TRACE is defined (build with
+-DSERPENS_TRACE and add trace.cpp), otherwise TRACE is nothing at all.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef SERPENS_TRACE
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//how many scopes each thread remembers, the oldest are written over. It has to be a power of two
+const int traceCapacity = 1 << 16;
+//how many different names TRACE can have, any past that are all saved as "other"
+const int traceNames = 1024;
+
+//one finished scope, kept small so a scope costs as little as possible. start and end are the low
+//halves of tracenow(), high is the top half at the end and span is how many times the top half
+//went up during the scope, so the whole times can be put back together when the trace is saved
+typedef struct traceevent {
+    uint32_t start, end, high;
+    uint16_t name, span;    //name is from tracename()
+} traceevent;
+
+//scope n goes in events[n % traceCapacity], written only goes up and is stored after
+//the scope is in, so the dump knows which ones are finished
+typedef struct tracebuffer {
+    traceevent events[traceCapacity];
+    std::atomic<unsigned> written;
+} tracebuffer;
+
+//the buffer for this thread, made by traceaddbuffer() the first time it records anything
+extern thread_local tracebuffer *tracemine;
+
+tracebuffer *traceaddbuffer();
+//the number for a scope's name, TRACE looks it up once for every place it's used
+uint16_t tracename(const char *name);
+bool tracedump(const char *path);
+
+//the time in some unit that goes up steadily. The processor's cycle counter is a lot quicker to
+//read than the clock, it's turned into real time when the trace is saved
+inline uint64_t tracenow() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//times the block it's declared in. Recording is done right here rather than in trace.cpp, so
+//apart from reading the time twice a scope is just a few stores into the thread's buffer
+typedef struct tracescope {
+    uint64_t start;
+    uint16_t name;
+    tracescope(uint16_t n) : start(tracenow()), name(n) {}
+    ~tracescope() {
+        uint64_t end = tracenow();
+        tracebuffer *b = tracemine;
+        if (b == NULL && (b = traceaddbuffer()) == NULL) return;
+        unsigned n = b->written.load(std::memory_order_relaxed);
+        traceevent *e = &b->events[n & (traceCapacity - 1)];
+        e->start = (uint32_t)start;
+        e->end = (uint32_t)end;
+        e->high = (uint32_t)(end >> 32);
+        e->name = name;
+        e->span = (uint16_t)((end >> 32) - (start >> 32));
+        b->written.store(n + 1, std::memory_order_release);
+    }
+} tracescope;
+
+#define TRACEJOIN(a, b) a##b
+#define TRACENAME(a, b) TRACEJOIN(a, b)
+//name has to be a string that's always there, like a literal
+#define TRACE(name) static const uint16_t TRACENAME(tracedname, __LINE__) = tracename(name); \
+    tracescope TRACENAME(traced, __LINE__)(TRACENAME(tracedname, __LINE__))
+#else
+#define TRACE(name)
+static inline bool tracedump(const char *) { return false; }
+#endif
+
+#endif